@@ -4,27 +4,163 @@ StatusLed::StatusLed(int powerPin, int dataPin)
     : _powerPin(powerPin), _dataPin(dataPin), _pixels(1, dataPin, NEO_GRB + NEO_KHZ800) {}
 
 void StatusLed::begin() {
+    if (!_lock) {
+        _lock = xSemaphoreCreateMutexStatic(&_lockBuffer);
+        const esp_timer_create_args_t args = {
+            .callback = onTimer,
+            .arg = this,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "status_led",
+            .skip_unhandled_events = true,
+        };
+        esp_timer_create(&args, &_timer);
+    }
     pinMode(_powerPin, OUTPUT);
     digitalWrite(_powerPin, HIGH); // Turn on power to LED
     _pixels.begin();
+    _begun = true;
     _pixels.clear();
     _pixels.show();
+    digitalWrite(_powerPin, LOW); // Rail stays off until an effect plays
 }
 
-void StatusLed::set(uint8_t r, uint8_t g, uint8_t b) {
+void StatusLed::show(uint8_t r, uint8_t g, uint8_t b) {
     digitalWrite(_powerPin, HIGH);
     _pixels.setPixelColor(0, _pixels.Color(r, g, b));
     _pixels.show();
 }
 
-void StatusLed::off() {
+void StatusLed::powerDown() {
     _pixels.clear();
     _pixels.show();
     digitalWrite(_powerPin, LOW); // Cut power to simple LED
 }
 
+void StatusLed::set(uint8_t r, uint8_t g, uint8_t b) {
+    if (!_begun) {
+        return;
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    esp_timer_stop(_timer);
+    _count = 0;
+    _playing = false;
+    show(r, g, b);
+    xSemaphoreGive(_lock);
+}
+
+void StatusLed::off() {
+    if (_begun) {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        esp_timer_stop(_timer);
+        _count = 0;
+        _playing = false;
+        powerDown();
+        xSemaphoreGive(_lock);
+    } else {
+        // Fast wakes never ran begin(): the pin is still an input after gpio_hold_dis
+        pinMode(_powerPin, OUTPUT);
+        digitalWrite(_powerPin, LOW);
+    }
+}
+
 void StatusLed::flash(uint8_t r, uint8_t g, uint8_t b, int duration) {
-    set(r, g, b);
-    delay(duration);
-    off();
+    blink(r, g, b, duration, 0, 1);
+}
+
+void StatusLed::blink(uint8_t r, uint8_t g, uint8_t b, uint16_t onMs, uint16_t offMs, uint8_t count) {
+    enqueue({ EFFECT_BLINK, r, g, b, onMs, offMs, count });
+}
+
+void StatusLed::pulse(uint8_t r, uint8_t g, uint8_t b, uint16_t periodMs, uint8_t count) {
+    enqueue({ EFFECT_PULSE, r, g, b, periodMs, 0, count });
+}
+
+bool StatusLed::isBusy() const {
+    return _playing;
+}
+
+void StatusLed::waitIdle(uint32_t timeoutMs) {
+    unsigned long start = millis();
+    while (_playing && millis() - start < timeoutMs) {
+        delay(5);
+    }
+}
+
+void StatusLed::enqueue(const Effect& effect) {
+    if (!_begun || effect.count == 0) {
+        return;
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (_count == LED_EFFECT_QUEUE_LEN) {
+        // Status is only worth showing while fresh: drop the oldest waiting effect
+        _head = (_head + 1) % LED_EFFECT_QUEUE_LEN;
+        _count--;
+    }
+    _queue[(_head + _count) % LED_EFFECT_QUEUE_LEN] = effect;
+    _count++;
+    bool start = !_playing;
+    if (start) {
+        _playing = true;
+        _phase = 0;
+    }
+    xSemaphoreGive(_lock);
+    if (start) {
+        step();
+    }
+}
+
+void StatusLed::onTimer(void* arg) {
+    static_cast<StatusLed*>(arg)->step();
+}
+
+// Renders the current phase of the head effect and arms the timer for the next one
+void StatusLed::step() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (!_playing) {
+        // esp_timer_stop() does not wait for a callback that already fired: this one ran
+        // after set()/off() and must not blank the colour they left
+        xSemaphoreGive(_lock);
+        return;
+    }
+    uint32_t nextMs = 0;
+    while (_count > 0 && nextMs == 0) {
+        Effect& e = _queue[_head];
+        if (e.kind == EFFECT_BLINK && _phase == 0) {
+            show(e.r, e.g, e.b);
+            nextMs = e.onMs;
+            _phase = 1;
+            continue;
+        }
+        if (e.kind == EFFECT_PULSE) {
+            uint16_t steps = (e.onMs / LED_PULSE_STEP_MS) & ~1u; // Even, so the peak is exact
+            if (steps < 2) steps = 2;
+            if (_phase < steps) {
+                // Triangle ramp up and back down over one period
+                uint16_t half = steps / 2;
+                uint16_t level = _phase < half ? _phase : steps - _phase;
+                show(e.r * level / half, e.g * level / half, e.b * level / half);
+                nextMs = LED_PULSE_STEP_MS;
+                _phase++;
+                continue;
+            }
+        }
+
+        // One repetition done: gap before the next, or on to the next effect
+        _phase = 0;
+        if (--e.count == 0) {
+            _head = (_head + 1) % LED_EFFECT_QUEUE_LEN;
+            _count--;
+        } else if (e.kind == EFFECT_BLINK && e.offMs > 0) {
+            show(0, 0, 0);
+            nextMs = e.offMs;
+        }
+    }
+
+    if (nextMs > 0) {
+        esp_timer_start_once(_timer, nextMs * 1000ULL);
+    } else {
+        powerDown();
+        _playing = false;
+    }
+    xSemaphoreGive(_lock);
 }
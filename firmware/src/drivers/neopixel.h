@@ -3,19 +3,58 @@
 
 #include <Arduino.h>
 #include <Adafruit_NeoPixel.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
+#define LED_EFFECT_QUEUE_LEN 4
+#define LED_PULSE_STEP_MS 20
+
+// Status LED with an asynchronous effect engine: flash(), blink() and pulse() queue an
+// effect and return at once; an esp_timer steps through the queue. The LED rail is only
+// powered while an effect is playing.
 class StatusLed {
 public:
     StatusLed(int powerPin, int dataPin);
     void begin();
-    void set(uint8_t r, uint8_t g, uint8_t b);
-    void off();
+    void set(uint8_t r, uint8_t g, uint8_t b); // Steady colour, cancels queued effects
+    void off();                                // Cancels queued effects and cuts the rail
     void flash(uint8_t r, uint8_t g, uint8_t b, int duration = 100);
+    void blink(uint8_t r, uint8_t g, uint8_t b, uint16_t onMs, uint16_t offMs, uint8_t count);
+    void pulse(uint8_t r, uint8_t g, uint8_t b, uint16_t periodMs, uint8_t count = 1);
+    bool isBusy() const;
+    // For the few places that must show an effect before sleeping or restarting
+    void waitIdle(uint32_t timeoutMs = 2000);
 
 private:
+    enum EffectKind : uint8_t { EFFECT_BLINK, EFFECT_PULSE };
+    struct Effect {
+        EffectKind kind;
+        uint8_t r, g, b;
+        uint16_t onMs;  // Pulse: full period
+        uint16_t offMs;
+        uint8_t count;
+    };
+
+    void enqueue(const Effect& effect);
+    static void onTimer(void* arg);
+    void step();
+    void show(uint8_t r, uint8_t g, uint8_t b);
+    void powerDown();
+
     int _powerPin;
     int _dataPin;
     Adafruit_NeoPixel _pixels;
+    bool _begun = false; // Pixel driver only touched after begin() (fast wakes never power the LED)
+
+    esp_timer_handle_t _timer = nullptr;
+    SemaphoreHandle_t _lock = nullptr;
+    StaticSemaphore_t _lockBuffer;
+    Effect _queue[LED_EFFECT_QUEUE_LEN];
+    uint8_t _head = 0;
+    uint8_t _count = 0;
+    volatile bool _playing = false;
+    uint16_t _phase = 0; // Blink: 0 = on, 1 = off. Pulse: step within the period
 };
 
 #endif // NEOPIXEL_H
@@ -1,46 +1,249 @@
 #include "tmp102.h"
 
+// Register pointers
+#define REG_TEMP    0x00
+#define REG_CONFIG  0x01
+#define REG_T_LOW   0x02
+#define REG_T_HIGH  0x03
+
+// Config register bits
+#define CFG1_SD     0x01
+#define CFG1_TM     0x02
+#define CFG1_POL    0x04
+#define CFG1_F_MASK 0x18
+#define CFG1_F_SHIFT 3
+#define CFG1_OS     0x80
+#define CFG2_EM     0x10
+#define CFG2_AL     0x20
+#define CFG2_CR_MASK 0xC0
+#define CFG2_CR_SHIFT 6
+
+// Shadow of the config register. The sensor stays powered through deep sleep,
+// so keeping the last written value in RTC memory lets every wake do a plain
+// write instead of a read-modify-write round trip.
+RTC_DATA_ATTR static uint8_t s_cfgAddr = 0;
+RTC_DATA_ATTR static uint8_t s_cfg1 = 0;
+RTC_DATA_ATTR static uint8_t s_cfg2 = 0;
+
 TMP102::TMP102(uint8_t addr) : _addr(addr), _wire(&Wire) {}
 
 bool TMP102::begin(int sda, int scl) {
+    if (s_cfgAddr == _addr) {
+        _extended = (s_cfg2 & CFG2_EM) != 0; // Restore decode mode after deep sleep
+    }
     return _wire->begin(sda, scl);
 }
 
 float TMP102::readTemperature() {
-    _wire->beginTransmission(_addr);
-    _wire->write(0x00); // Temperature register
-    if (_wire->endTransmission() != 0) {
+    return readTempRegister(REG_TEMP);
+}
+
+bool TMP102::shutdown() {
+    if (_isShutdown) {
+        return true; // One-shot already left it in shutdown
+    }
+    _isShutdown = updateConfig(CFG1_SD | CFG1_OS, CFG1_SD, 0, 0);
+    return _isShutdown;
+}
+
+void TMP102::wakeup() {
+    updateConfig(CFG1_SD | CFG1_OS, 0, 0, 0); // SD bit low
+    _isShutdown = false;
+    _oneShotPending = false;
+    _conversionStartMs = millis();
+}
+
+void TMP102::waitForConversion() {
+    if (_oneShotPending) {
+        // Sleep through the typical time, then poll OS until the result is latched
+        unsigned long elapsed = millis() - _conversionStartMs;
+        if (elapsed < TMP102_CONVERSION_TYP_MS) {
+            delay(TMP102_CONVERSION_TYP_MS - elapsed);
+        }
+        while (!isConversionReady() && (millis() - _conversionStartMs < TMP102_CONVERSION_MS + 5)) {
+            delay(1);
+        }
+        _oneShotPending = false;
+        return;
+    }
+
+    unsigned long elapsed = millis() - _conversionStartMs;
+    if (elapsed < TMP102_CONVERSION_MS) {
+        delay(TMP102_CONVERSION_MS - elapsed);
+    }
+}
+
+bool TMP102::startOneShot() {
+    // OS + SD: single conversion, then back to shutdown
+    if (!updateConfig(CFG1_SD | CFG1_OS, CFG1_SD | CFG1_OS, 0, 0)) {
+        return false;
+    }
+    _isShutdown = true;
+    _oneShotPending = true;
+    _conversionStartMs = millis();
+    return true;
+}
+
+bool TMP102::isConversionReady() {
+    uint8_t b1, b2;
+    if (!readConfig(b1, b2)) {
+        return false;
+    }
+    return (b1 & CFG1_OS) != 0; // OS reads 0 while converting
+}
+
+float TMP102::readOneShot() {
+    if (!startOneShot()) {
         return NAN;
     }
+    waitForConversion();
+    return readTemperature();
+}
+
+bool TMP102::setConversionRate(ConversionRate rate) {
+    return updateConfig(0, 0, CFG2_CR_MASK, (uint8_t)rate << CFG2_CR_SHIFT);
+}
+
+bool TMP102::setExtendedMode(bool enable) {
+    if (!updateConfig(0, 0, CFG2_EM, enable ? CFG2_EM : 0)) {
+        return false;
+    }
+    _extended = enable;
+    return true;
+}
+
+bool TMP102::setFaultQueue(FaultQueue faults) {
+    return updateConfig(CFG1_F_MASK, (uint8_t)faults << CFG1_F_SHIFT, 0, 0);
+}
+
+bool TMP102::setAlertPolarity(AlertPolarity polarity) {
+    return updateConfig(CFG1_POL, polarity == ALERT_ACTIVE_HIGH ? CFG1_POL : 0, 0, 0);
+}
+
+bool TMP102::setThermostatMode(ThermostatMode mode) {
+    return updateConfig(CFG1_TM, mode == MODE_INTERRUPT ? CFG1_TM : 0, 0, 0);
+}
+
+bool TMP102::setLowThreshold(float tempC) {
+    return writeTempRegister(REG_T_LOW, tempC);
+}
+
+bool TMP102::setHighThreshold(float tempC) {
+    return writeTempRegister(REG_T_HIGH, tempC);
+}
+
+float TMP102::getLowThreshold() {
+    return readTempRegister(REG_T_LOW);
+}
+
+float TMP102::getHighThreshold() {
+    return readTempRegister(REG_T_HIGH);
+}
+
+bool TMP102::isAlertActive() {
+    uint8_t b1, b2;
+    if (!readConfig(b1, b2)) {
+        return false;
+    }
+    bool al = (b2 & CFG2_AL) != 0;
+    // AL reads with the same polarity as the ALERT pin
+    return (b1 & CFG1_POL) ? al : !al;
+}
+
+bool TMP102::readConfig(uint8_t& byte1, uint8_t& byte2) {
+    return readRegister(REG_CONFIG, byte1, byte2);
+}
 
+bool TMP102::readRegister(uint8_t reg, uint8_t& msb, uint8_t& lsb) {
+    _wire->beginTransmission(_addr);
+    _wire->write(reg);
+    if (_wire->endTransmission() != 0) {
+        return false;
+    }
     if (_wire->requestFrom(_addr, (uint8_t)2) != 2) {
-        return NAN;
+        return false;
     }
+    msb = _wire->read();
+    lsb = _wire->read();
+    return true;
+}
 
-    uint8_t msb = _wire->read();
-    uint8_t lsb = _wire->read();
+float TMP102::readTempRegister(uint8_t reg) {
+    uint8_t msb, lsb;
+    if (!readRegister(reg, msb, lsb)) {
+        return NAN;
+    }
 
-    // 12-bit resolution
-    int16_t val = (msb << 4) | (lsb >> 4);
-    if (val > 0x7FF) {
-        val |= 0xF000;
+    int16_t val;
+    if (reg == REG_TEMP ? (lsb & 0x01) : _extended) {
+        // 13-bit extended mode (temperature register flags EM in bit 0 of the LSB)
+        val = (msb << 5) | (lsb >> 3);
+        if (val > 0xFFF) {
+            val |= 0xE000;
+        }
+    } else {
+        // 12-bit resolution
+        val = (msb << 4) | (lsb >> 4);
+        if (val > 0x7FF) {
+            val |= 0xF000;
+        }
     }
 
     return val * 0.0625;
 }
 
-bool TMP102::shutdown() {
+bool TMP102::writeTempRegister(uint8_t reg, float tempC) {
+    // Clamp to what the register holds: 12-bit -128..127.9375C, 13-bit -256..255.9375C
+    int32_t maxCounts = _extended ? 4095 : 2047;
+    float scaled = tempC / 0.0625f;
+    if (isnan(scaled)) {
+        return false;
+    }
+    int32_t counts;
+    if (scaled >= (float)maxCounts) {
+        counts = maxCounts;
+    } else if (scaled <= (float)(-maxCounts - 1)) {
+        counts = -maxCounts - 1;
+    } else {
+        counts = lroundf(scaled);
+    }
+    // Shift as unsigned: left-shifting a negative value is undefined
+    uint16_t raw = (uint16_t)((uint16_t)counts << (_extended ? 3 : 4));
+
     _wire->beginTransmission(_addr);
-    _wire->write(0x01); // Config register
-    _wire->write(0x01); // SD bit high (byte 1)
-    _wire->write(0x00); // byte 2
+    _wire->write(reg);
+    _wire->write((uint8_t)(raw >> 8));
+    _wire->write((uint8_t)(raw & 0xFF));
     return (_wire->endTransmission() == 0);
 }
 
-void TMP102::wakeup() {
+bool TMP102::updateConfig(uint8_t mask1, uint8_t bits1, uint8_t mask2, uint8_t bits2) {
+    uint8_t b1 = s_cfg1;
+    uint8_t b2 = s_cfg2;
+    if (s_cfgAddr != _addr) {
+        // No shadow yet (cold boot): fetch the live register once
+        if (!readConfig(b1, b2)) {
+            return false;
+        }
+    }
+    // OS is a command bit, never carry it over from a previous read/write
+    b1 = (b1 & ~(mask1 | CFG1_OS)) | bits1;
+    b2 = (b2 & ~mask2) | bits2;
+    if (!writeConfig(b1, b2)) {
+        return false;
+    }
+    // Shadow only becomes valid once the sensor holds what it describes
+    s_cfgAddr = _addr;
+    s_cfg1 = b1 & ~CFG1_OS;
+    s_cfg2 = b2;
+    _extended = (b2 & CFG2_EM) != 0;
+    return true;
+}
+
+bool TMP102::writeConfig(uint8_t byte1, uint8_t byte2) {
     _wire->beginTransmission(_addr);
-    _wire->write(0x01); // Config register
-    _wire->write(0x00); // SD bit low (byte 1)
-    _wire->write(0x00); // byte 2
-    _wire->endTransmission();
+    _wire->write(REG_CONFIG);
+    _wire->write(byte1);
+    _wire->write(byte2);
+    return (_wire->endTransmission() == 0);
 }
@@ -4,17 +4,79 @@
 #include <Arduino.h>
 #include <Wire.h>
 
+// Conversion time (datasheet: 26ms typical, 35ms max)
+#define TMP102_CONVERSION_MS 35
+#define TMP102_CONVERSION_TYP_MS 26
+
 class TMP102 {
 public:
+    // Config register fields (datasheet table 10)
+    enum ConversionRate : uint8_t {
+        RATE_0_25HZ = 0,
+        RATE_1HZ    = 1,
+        RATE_4HZ    = 2, // Power-on default
+        RATE_8HZ    = 3
+    };
+    enum FaultQueue : uint8_t {
+        FAULTS_1 = 0,
+        FAULTS_2 = 1,
+        FAULTS_4 = 2,
+        FAULTS_6 = 3
+    };
+    enum AlertPolarity : uint8_t {
+        ALERT_ACTIVE_LOW  = 0,
+        ALERT_ACTIVE_HIGH = 1
+    };
+    enum ThermostatMode : uint8_t {
+        MODE_COMPARATOR = 0, // ALERT held while T >= T_HIGH, released below T_LOW
+        MODE_INTERRUPT  = 1  // ALERT pulses on each crossing, cleared by a register read
+    };
+
     TMP102(uint8_t addr = 0x48);
     bool begin(int sda, int scl);
     float readTemperature();
     bool shutdown();
     void wakeup();
+    // Blocks only for whatever is left of the conversion started by wakeup(),
+    // so callers can do other init work while the sensor converts.
+    void waitForConversion();
+
+    // One-shot mode: sensor stays in shutdown and converts once per call.
+    // startOneShot() sets OS while SD is held, so a wake costs one config write
+    // plus the temperature read, and no continuous-mode current is drawn.
+    bool startOneShot();
+    bool isConversionReady();
+    float readOneShot();
+
+    // Configuration (read-modify-write, other fields are preserved)
+    bool setConversionRate(ConversionRate rate);
+    bool setExtendedMode(bool enable); // 13-bit, range up to 150C
+    bool setFaultQueue(FaultQueue faults);
+    bool setAlertPolarity(AlertPolarity polarity);
+    bool setThermostatMode(ThermostatMode mode);
+    bool isExtendedMode() const { return _extended; }
+
+    // Alert thresholds (T_LOW / T_HIGH registers, same format as the temperature)
+    bool setLowThreshold(float tempC);
+    bool setHighThreshold(float tempC);
+    float getLowThreshold();
+    float getHighThreshold();
+    bool isAlertActive(); // AL bit, already corrected for polarity
 
 private:
+    bool readConfig(uint8_t& byte1, uint8_t& byte2);
+    bool writeConfig(uint8_t byte1, uint8_t byte2);
+    bool updateConfig(uint8_t mask1, uint8_t bits1, uint8_t mask2, uint8_t bits2);
+    bool readRegister(uint8_t reg, uint8_t& msb, uint8_t& lsb);
+    bool writeTempRegister(uint8_t reg, float tempC);
+    float readTempRegister(uint8_t reg);
+
     uint8_t _addr;
     TwoWire *_wire;
+    unsigned long _conversionStartMs = 0;
+    bool _oneShotPending = false;
+    bool _isShutdown = false; // Known to be in SD mode (skip redundant shutdown writes)
+    bool _extended = false;
 };
 
 #endif // TMP102_H
@@ -5,8 +5,27 @@
 #include "drivers/neopixel.h"
 #include "services/ble_service.h"
 #include <services/espnow_service.h>
+#include "services/temp_alarm.h"
+#include "services/sample_buffer.h"
+#include "services/report_policy.h"
+#include "services/adaptive_scheduler.h"
+#include "services/history_log.h"
+#include "services/temp_stats.h"
+#include "services/link_control.h"
+#include "services/link_stats.h"
+#include "services/slot_schedule.h"
+#include "services/clock_cal.h"
+#include "services/remote_config.h"
+#include "services/ble_beacon.h"
+#include "services/logger.h"
+#include "services/alloc_counter.h"
+#include "temp_frame_codec.h"
 #include <nvs_flash.h>
 #include <driver/gpio.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
 #include <WiFiClientSecure.h>
 
 // Pins
@@ -16,6 +35,11 @@
 #define NEOPIXEL_PWR 5
 #define NEOPIXEL_DATA 3
 #define BOOT_PIN 9
+// TMP102 ALERT -> deep-sleep wake. Not routed on HW1/HW2; boards that wire it to
+// an RTC-capable GPIO (0-5 on the C3) set this via build_flags.
+#ifndef TMP102_ALERT_PIN
+#define TMP102_ALERT_PIN -1
+#endif
 
 #include <OTA-Hub.hpp>
 #include <ota-github-cacerts.h>
@@ -28,43 +52,804 @@ Preferences preferences;
 // Constants
 #define DEFAULT_SLEEP_MS 900000 // 15 minutes
 #define AWAKE_TIME_MS 30000     // Stay awake for 30s to allow connections
+#define TIMER_WAKE_LISTEN_MS 30 // Post-uplink RX window for gateway OTA triggers and config commands
+#define DEFAULT_DIAG_SEC 0      // Link diagnostics cadence, off unless set over BLE
+
+// Serial log output on timer wakes. Release builds set 0: the fast path then never touches
+// USB CDC and its messages only land in the log ring.
+#ifndef LOG_TIMER_WAKE_SERIAL
+#define LOG_TIMER_WAKE_SERIAL 1
+#endif
+#define AWAKE_SAMPLE_MS 5000    // Reading + ESP-NOW update period while a BLE client is connected
+#define LOOP_IDLE_MAX_MS 1000   // Longest loop() wait without an event (LED heartbeat, timeouts)
+#define LOOP_STREAM_POLL_MS 5   // loop() wait while a history download is streaming
+
+// CPU clock for the awake (full boot) mode, which mostly blocks in loop(). The prebuilt
+// Arduino sdkconfig has no CONFIG_PM_ENABLE, so there is no DFS or automatic light sleep.
+#ifndef AWAKE_CPU_MHZ
+#define AWAKE_CPU_MHZ 80 // Lowest clock Wi-Fi and BLE still run at
+#endif
+
+// Uplink ACK handling, overridable via build_flags
+#ifndef UPLINK_ACK_TIMEOUT_MS
+#define UPLINK_ACK_TIMEOUT_MS 100
+#endif
+#ifndef UPLINK_RETRIES
+#define UPLINK_RETRIES 1
+#endif
+#ifndef UPLINK_BACKOFF_MS
+#define UPLINK_BACKOFF_MS 20
+#endif
+static const EspNowSendOptions kUplinkSend = { UPLINK_ACK_TIMEOUT_MS, UPLINK_RETRIES, UPLINK_BACKOFF_MS };
 
 unsigned long stateStartTime = 0;
 bool isStayingAwake = false;
 
 uint8_t g_pairedMac[6] = {0}; // Global storage for paired MAC
 bool g_isTimerWakeup = false;
+bool g_isAlertWakeup = false;
 
 volatile bool g_indirectOtaPending = false;
 struct_message_ota_trigger g_otaTrigger;
 
+// loop() blocks on these instead of polling
+#define LOOP_EVT_BLE BIT0    // Client connected/disconnected, or a write loop() acts on
+#define LOOP_EVT_ESPNOW BIT1 // Gateway command queued or listen window extended
+#define LOOP_EVT_SAMPLE BIT2 // AWAKE_SAMPLE_MS tick
+#define LOOP_EVT_OTA BIT3    // OTA requested over ESP-NOW or BLE
+#define LOOP_EVT_ALL (LOOP_EVT_BLE | LOOP_EVT_ESPNOW | LOOP_EVT_SAMPLE | LOOP_EVT_OTA)
+static StaticEventGroup_t s_loopEventsBuffer;
+static EventGroupHandle_t g_loopEvents = nullptr; // Also wakes the timer-wake listen window
+static esp_timer_handle_t g_sampleTimer = nullptr;
+
+static void signalLoop(EventBits_t bits) {
+    if (g_loopEvents) {
+        xEventGroupSetBits(g_loopEvents, bits);
+    }
+}
+
 void onDataRecv(const uint8_t * mac, const uint8_t *incomingData, int len) {
+    if (memcmp(mac, g_pairedMac, 6) == 0) {
+        espNowService.noteGatewayHeard(); // Gateway traffic pins its channel
+        if (espNowService.getLastRssi() != 0) {
+            linkStats.recordRssi(espNowService.getLastRssi());
+        }
+
+        if (len == sizeof(struct_message_slot_assign)) {
+            struct_message_slot_assign slot;
+            memcpy(&slot, incomingData, sizeof(slot));
+            if (slot.messageID == 111) {
+                slotSchedule.assign(slot.periodMs, slot.slotInMs);
+                LOG_I("[ESP-NOW] Slot: every %u ms, next in %u ms", slot.periodMs, slot.slotInMs);
+                return;
+            }
+        }
+
+        if (remoteConfig.onReceive(incomingData, len)) {
+            signalLoop(LOOP_EVT_ESPNOW); // Applied from the main task
+            return;
+        }
+
+        if (len == sizeof(struct_message_time_sync)) {
+            struct_message_time_sync sync;
+            memcpy(&sync, incomingData, sizeof(sync));
+            if (sync.messageID == 112) {
+                clockCal.onTimeSync(sync.gatewayMs);
+                return;
+            }
+        }
+    }
     if (len == sizeof(struct_message_ota_trigger)) {
         struct_message_ota_trigger trigger;
         memcpy(&trigger, incomingData, sizeof(trigger));
         if (trigger.messageID == 110) {
             trigger.version[sizeof(trigger.version)-1] = '\0'; // Safety
-            Serial.printf("[ESP-NOW] OTA Trigger: Ver='%s' (Current='%s'), Force=%d\n", 
+            LOG_I("[ESP-NOW] OTA Trigger: Ver='%s' (Current='%s'), Force=%d", 
                           trigger.version, OTA_VERSION, trigger.force);
 
             if (!trigger.force && strcmp(trigger.version, OTA_VERSION) == 0) {
-                Serial.println("[ESP-NOW] OTA Ignored: Already on target version.");
+                LOG_W("[ESP-NOW] OTA Ignored: Already on target version.");
                 return;
             }
 
-            Serial.println("[ESP-NOW] OTA Trigger Accepted!");
+            LOG_I("[ESP-NOW] OTA Trigger Accepted!");
             memcpy((void*)&g_otaTrigger, &trigger, sizeof(g_otaTrigger));
             g_indirectOtaPending = true;
+            signalLoop(LOOP_EVT_OTA);
+        }
+    }
+}
+
+// Per-phase wake timing. Build with -DWAKE_PIPELINE_SEQUENTIAL to get the old
+// convert-then-init ordering for comparison.
+#define MAX_WAKE_PHASES 8
+struct WakePhase {
+    const char* name;
+    uint32_t us;
+};
+static WakePhase g_wakePhases[MAX_WAKE_PHASES];
+static uint8_t g_wakePhaseCount = 0;
+
+// Heap use per wake cycle (debug builds): the wake path should not allocate, so every
+// malloc/calloc/realloc call counted between boot and sleep is a regression, including
+// ones freed again before sleep. Net blocks show what stays allocated.
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+static multi_heap_info_t g_heapAtWake;
+static uint32_t g_allocsAtWake;
+#endif
+
+static void markWakeStart() {
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    heap_caps_get_info(&g_heapAtWake, MALLOC_CAP_8BIT);
+    g_allocsAtWake = allocCounter.count();
+#endif
+}
+
+static void markWakePhase(const char* name) {
+    if (g_wakePhaseCount < MAX_WAKE_PHASES) {
+        g_wakePhases[g_wakePhaseCount++] = { name, (uint32_t)micros() };
+    }
+}
+
+static void printWakePhases() {
+    uint32_t prev = 0;
+    for (uint8_t i = 0; i < g_wakePhaseCount; i++) {
+        LOG_I("[WAKE] %-12s +%5lu us (t=%lu us)", g_wakePhases[i].name,
+                      (unsigned long)(g_wakePhases[i].us - prev), (unsigned long)g_wakePhases[i].us);
+        prev = g_wakePhases[i].us;
+    }
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    multi_heap_info_t heap;
+    heap_caps_get_info(&heap, MALLOC_CAP_8BIT);
+    if (allocCounter.isEnabled()) {
+        LOG_D("[WAKE] heap: %u allocs this wake", (unsigned)(allocCounter.count() - g_allocsAtWake));
+    }
+    LOG_D("[WAKE] heap: net %+d blocks, %+d bytes, largest free %u",
+          (int)heap.allocated_blocks - (int)g_heapAtWake.allocated_blocks,
+          (int)heap.total_allocated_bytes - (int)g_heapAtWake.total_allocated_bytes,
+          (unsigned)heap.largest_free_block);
+#endif
+}
+
+#define NAME_PREFIX "AE Temp Sensor - "
+#define NAME_SUFFIX_MAX (NAME_SUFFIX_MAX_LEN + 1) // Incl. terminator
+
+// Telemetry frame shared by every uplink path. The static fields are filled once by
+// loadDeviceName(); fillTelemetry() only patches the per-reading ones, so no uplink
+// allocates or copies strings.
+static TempSensorData g_telemetry;
+static char g_deviceName[sizeof(NAME_PREFIX) - 1 + NAME_SUFFIX_MAX]; // BLE name; the frame keeps the first 31 characters
+
+// (Re)builds the device name and the frame template from the NVS name suffix
+static void loadDeviceName() {
+    char suffix[NAME_SUFFIX_MAX] = "";
+    preferences.getString("name", suffix, sizeof(suffix));
+    if (suffix[0] != '\0') {
+        snprintf(g_deviceName, sizeof(g_deviceName), NAME_PREFIX "%s", suffix);
+    } else {
+        strcpy(g_deviceName, "AE Temp Sensor");
+    }
+
+    memset(&g_telemetry, 0, sizeof(g_telemetry));
+    g_telemetry.id = 22;
+    g_telemetry.batteryVoltage = 3.3; // Placeholder
+    g_telemetry.batteryLevel = 100;   // Placeholder
+    g_telemetry.hardwareVersion = HW_VERSION;
+    strncpy(g_telemetry.firmwareVersion, OTA_VERSION, sizeof(g_telemetry.firmwareVersion) - 1);
+    strncpy(g_telemetry.name, g_deviceName, sizeof(g_telemetry.name) - 1);
+}
+
+static volatile bool g_nameChanged = false; // Set from the BLE task
+
+static const TempSensorData& fillTelemetry(float temp, uint32_t interval) {
+    g_telemetry.temperature = temp;
+    g_telemetry.updateInterval = interval;
+    return g_telemetry;
+}
+
+// True when the hardware comparator wakes us: thresholds set and ALERT routed. Otherwise
+// an armed alarm is checked in software against each one-shot reading.
+static bool isAlertWakeArmed() {
+    return TMP102_ALERT_PIN >= 0 && tempAlarm.isArmed();
+}
+
+// Program the TMP102 comparator for the configured thresholds. While armed the sensor
+// keeps converting (1Hz) through deep sleep so ALERT can wake us.
+static void applyAlarmConfig() {
+    if (!isAlertWakeArmed()) {
+        return;
+    }
+    tmp102.setThermostatMode(TMP102::MODE_COMPARATOR);
+    tmp102.setAlertPolarity(TMP102::ALERT_ACTIVE_LOW);
+    tmp102.setFaultQueue(TMP102::FAULTS_1);
+    tmp102.setConversionRate(TMP102::RATE_1HZ);
+    tmp102.setLowThreshold(tempAlarm.getLow());
+    tmp102.setHighThreshold(tempAlarm.getHigh());
+    tmp102.wakeup();
+    LOG_I("[ALARM] Armed: low=%.2f high=%.2f", tempAlarm.getLow(), tempAlarm.getHigh());
+}
+
+// Queues the alarm frame and returns without waiting so telemetry can follow back to back.
+// Complete it with finishSend(handle, &g_alarmFrame, sizeof(g_alarmFrame)).
+static TempAlarmData g_alarmFrame;
+
+static EspNowHandle sendAlarmFrame(float temp) {
+    TempAlarmData& alarm = g_alarmFrame;
+    memset(&alarm, 0, sizeof(alarm));
+    alarm.id = 23;
+    alarm.temperature = temp;
+    alarm.thresholdLow = tempAlarm.getLow();
+    alarm.thresholdHigh = tempAlarm.getHigh();
+    alarm.active = tempAlarm.isActive() ? 1 : 0;
+    strncpy(alarm.name, g_deviceName, sizeof(alarm.name) - 1);
+    return espNowService.sendAlarm(alarm, g_pairedMac);
+}
+
+// Waits for a queued unicast; on failure falls back to the remaining kUplinkSend retries
+static bool finishSend(EspNowHandle handle, const void* payload, size_t len) {
+    if (espNowService.wait(handle, UPLINK_ACK_TIMEOUT_MS)) {
+        return true;
+    }
+    EspNowSendOptions retry = kUplinkSend;
+    if (retry.retries == 0) {
+        return false;
+    }
+    retry.retries--;
+    linkStats.recordRetry();
+    delay(retry.backoffMs);
+    retry.backoffMs *= 2;
+    return espNowService.sendAndWait(g_pairedMac, (const uint8_t*)payload, len, retry);
+}
+
+static void initFrameHeader(temp_frame_header_t& hdr, uint32_t intervalMs, uint32_t firstSeq) {
+    hdr = {};
+    hdr.hardwareVersion = HW_VERSION;
+    hdr.deviceTime = SampleBuffer::now();
+    hdr.intervalSec = (intervalMs / 1000 > UINT16_MAX) ? UINT16_MAX : (uint16_t)(intervalMs / 1000);
+    hdr.firstSeq = firstSeq;
+}
+
+static bool sendFrame(const TempFrameEncoder& encoder, const uint8_t* frame) {
+    LOG_D("=== Sending Frame: %u samples, %u bytes ===", encoder.count(), (unsigned)encoder.length());
+    return espNowService.sendAndWait(g_pairedMac, frame, encoder.length(), kUplinkSend);
+}
+
+// Assigns the reading its uplink sequence number and appends it to the flash history
+static uint32_t logReading(uint32_t now, float temp, uint8_t flags) {
+    historyLog.begin();
+    if (!historyLog.isSeqRestored()) {
+        historyLog.restoreSeq(preferences.getUInt("seq_ctr", 0));
+    }
+    if (historyLog.needsSeqReserve()) {
+        preferences.putUInt("seq_ctr", historyLog.getSeqReserve());
+        historyLog.confirmSeqReserve();
+    }
+    uint32_t seq = historyLog.takeSeq();
+    historyLog.append(seq, now, isnan(temp) ? TEMP_FRAME_INVALID_TEMP : (int16_t)lroundf(temp * 100.0f), flags);
+    return seq;
+}
+
+// Send the RTC sample buffer as one compact batch frame (as many samples as fit,
+// oldest first). Samples are dropped only once the gateway has ACKed them.
+static bool flushSampleBuffer(uint32_t intervalMs) {
+    static uint8_t frame[TEMP_FRAME_MAX_LEN];
+    TempSample sample;
+    if (!sampleBuffer.peek(0, sample)) {
+        return true;
+    }
+    temp_frame_header_t hdr;
+    initFrameHeader(hdr, intervalMs, sample.seq);
+    // Deadband filtering leaves holes in the sequence
+    for (uint8_t i = 1; sampleBuffer.peek(i, sample); i++) {
+        TempSample prev;
+        sampleBuffer.peek(i - 1, prev);
+        if (sample.seq != prev.seq + 1) {
+            hdr.flags |= TEMP_FRAME_FLAG_SEQ_GAPS;
+            break;
+        }
+    }
+
+    TempFrameEncoder encoder(frame, sizeof(frame));
+    encoder.begin(hdr);
+    // Hourly/daily rollups ride along so the gateway gets summaries without reducing raw samples
+    temp_frame_aggregate_t aggregates[2];
+    uint8_t aggregateCount = tempStats.hasData() ? 2 : 0;
+    if (aggregateCount) {
+        tempStats.get(TempStats::HOUR, aggregates[0]);
+        tempStats.get(TempStats::DAY, aggregates[1]);
+    }
+    temp_frame_link_t link = { linkControl.getTxPower(), linkControl.getRate(), linkControl.getAckPercent() };
+    // Delivery statistics on their own (configurable) cadence
+    temp_frame_diag_t diag;
+    bool withDiag = linkStats.isReportDue(hdr.deviceTime);
+    if (withDiag) {
+        linkStats.snapshot(diag);
+    }
+    encoder.reserve((aggregateCount ? 1 + sizeof(aggregates) : 0) + sizeof(link) + (withDiag ? sizeof(diag) : 0));
+    while (sampleBuffer.peek(encoder.count(), sample) &&
+           encoder.addSample(sample.timestamp, sample.centiC, sample.seq)) {
+    }
+    uint8_t sent = encoder.count();
+    if (aggregateCount) {
+        hdr.flags |= TEMP_FRAME_FLAG_AGGREGATES;
+        encoder.appendBytes(&aggregateCount, 1);
+        encoder.appendBytes(aggregates, sizeof(aggregates));
+    }
+    encoder.appendBytes(&link, sizeof(link));
+    hdr.flags |= TEMP_FRAME_FLAG_LINK;
+    if (withDiag) {
+        encoder.appendBytes(&diag, sizeof(diag));
+        hdr.flags |= TEMP_FRAME_FLAG_DIAG;
+    }
+    encoder.setFlags(hdr.flags);
+
+    bool acked = sendFrame(encoder, frame);
+    if (acked) {
+        linkStats.markLinkReported(link);
+        // Deadband and heartbeat run from what the gateway actually has
+        if (sent > 0 && sampleBuffer.peek(sent - 1, sample)) {
+            reportPolicy.markReported(sample.centiC == TEMP_FRAME_INVALID_TEMP ? NAN : sample.centiC / 100.0f,
+                                      sample.timestamp);
+        }
+        sampleBuffer.drop(sent);
+        if (withDiag) {
+            linkStats.markReported(hdr.deviceTime);
+        }
+    }
+    return acked;
+}
+
+// Sections-only batch frame (no samples) after a legacy uplink. Carries the closed-loop
+// TX power, PHY rate and ACK rate whenever power or rate moved since the gateway last heard
+// them (linkUpdates), plus the delivery statistics when the diagnostics cadence is due.
+static bool sendStatusFrame(uint32_t intervalMs, bool linkUpdates) {
+    static uint8_t frame[TEMP_FRAME_HEADER_LEN + sizeof(temp_frame_link_t) + sizeof(temp_frame_diag_t)];
+    temp_frame_header_t hdr;
+    initFrameHeader(hdr, intervalMs, 0);
+    temp_frame_link_t link = { linkControl.getTxPower(), linkControl.getRate(), linkControl.getAckPercent() };
+    bool withDiag = linkStats.isReportDue(hdr.deviceTime);
+    if (!withDiag && !(linkUpdates && linkStats.isLinkReportDue(link))) {
+        return true;
+    }
+    temp_frame_diag_t diag;
+    hdr.flags = TEMP_FRAME_FLAG_LINK;
+    if (withDiag) {
+        linkStats.snapshot(diag);
+        hdr.flags |= TEMP_FRAME_FLAG_DIAG;
+    }
+    TempFrameEncoder encoder(frame, sizeof(frame));
+    encoder.begin(hdr);
+    encoder.appendBytes(&link, sizeof(link));
+    if (withDiag) {
+        encoder.appendBytes(&diag, sizeof(diag));
+    }
+
+    bool acked = sendFrame(encoder, frame);
+    if (acked) {
+        linkStats.markLinkReported(link);
+        if (withDiag) {
+            linkStats.markReported(hdr.deviceTime);
+        }
+    }
+    return acked;
+}
+
+// Replays samples that fell out of the RTC buffer during an outage from the flash history log
+static bool flushOverflow(uint32_t intervalMs) {
+    static uint8_t frame[TEMP_FRAME_MAX_LEN];
+    static history_record_t records[64];
+    uint32_t from, to;
+    if (!sampleBuffer.getOverflow(from, to)) {
+        return true;
+    }
+    // Starts at the oldest stored seq >= from: overwritten or never stored ones are skipped
+    size_t n = (from < to) ? historyLog.readSamples(from, records, 64, from) : 0;
+    if (n > 0 && from >= to) {
+        n = 0;
+    } else if (n > to - from) {
+        n = to - from;
+    }
+    if (n == 0) {
+        // Log wrapped past them (or no history partition): nothing left to replay
+        LOG_I("[BACKFILL] Samples before %u lost", to);
+        sampleBuffer.ackOverflow(to);
+        return true;
+    }
+
+    temp_frame_header_t hdr;
+    initFrameHeader(hdr, intervalMs, from);
+    TempFrameEncoder encoder(frame, sizeof(frame));
+    encoder.begin(hdr);
+    uint32_t lastTime = records[0].timestamp;
+    for (size_t i = 0; i < n; i++) {
+        // Torn records keep their slot so the sequence stays contiguous
+        bool valid = HistoryLog::isValid(records[i]);
+        if (valid) {
+            lastTime = records[i].timestamp;
+        }
+        if (!encoder.addSample(lastTime, valid ? records[i].centiC : TEMP_FRAME_INVALID_TEMP, from + i)) {
+            break;
+        }
+    }
+
+    bool acked = sendFrame(encoder, frame);
+    if (acked) {
+        LOG_I("[BACKFILL] Replayed %u samples from %u", encoder.count(), from);
+        sampleBuffer.ackOverflow(from + encoder.count());
+    }
+    return acked;
+}
+
+// Store-and-forward: after an outage, drain the backlog (oldest first) in up to
+// MAX_BACKFILL_FRAMES frames per wake. Stops at the first failed send.
+#define MAX_BACKFILL_FRAMES 8
+static bool uplinkBacklog(uint32_t intervalMs) {
+    for (int i = 0; i < MAX_BACKFILL_FRAMES && sampleBuffer.count() > 0; i++) {
+        uint32_t from, to;
+        bool ok = sampleBuffer.getOverflow(from, to) ? flushOverflow(intervalMs)
+                                                     : flushSampleBuffer(intervalMs);
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Persist the learned gateway channel so power cycles skip the sweep too
+static void saveGatewayChannel() {
+    uint8_t channel = espNowService.getChannel();
+    if (channel != 0 && channel != preferences.getUChar("gw_ch", 0)) {
+        preferences.putUChar("gw_ch", channel);
+        LOG_I("Saved Gateway Channel to NVS: %u", channel);
+    }
+}
+
+// Find the gateway again after repeated failures with an empty batch frame (ACK only)
+static void findGateway() {
+    uint8_t probe[TEMP_FRAME_HEADER_LEN];
+    temp_frame_header_t hdr;
+    initFrameHeader(hdr, 0, 0);
+    TempFrameEncoder encoder(probe, sizeof(probe));
+    encoder.begin(hdr);
+    espNowService.sweepForPeer(probe, encoder.length(), g_pairedMac);
+}
+
+// Passive-scan telemetry for phones and gateways, before the radio decision
+static void sendBeacon(float temp, uint32_t seq, const char* keyHex) {
+    if (!bleBeacon.isNonceRestored()) {
+        bleBeacon.restoreNonce(preferences.getUInt("bcn_ctr", 0));
+    }
+    if (bleBeacon.isNonceExhausted()) {
+        LOG_E("[BLE] Beacon nonces used up under this key: beacon off until re-paired");
+        return;
+    }
+    if (bleBeacon.needsNonceReserve()) {
+        preferences.putUInt("bcn_ctr", bleBeacon.getNonceReserve());
+        bleBeacon.confirmNonceReserve();
+    }
+
+    ae_beacon_temp_record record;
+    record.centiC = isnan(temp) ? INT16_MIN : (int16_t)lroundf(temp * 100.0f);
+    record.batteryMv = 3300;  // Placeholder, as in fillTelemetry()
+    record.batteryLevel = 100;
+    record.flags = (tempAlarm.isActive() ? AE_BEACON_FLAG_ALARM : 0) |
+                   (isnan(temp) ? AE_BEACON_FLAG_SENSOR_FAULT : 0);
+    record.seq = seq;
+    bleBeacon.sendBurst(record, keyHex);
+    markWakePhase("beacon");
+}
+
+// Batch frames (id 25) only go to gateways known to decode them: batching was configured
+// over BLE, or the gateway announced support with CONFIG_CMD_FEATURES. Otherwise every
+// reading goes out as the legacy id 22 frame and missed ones are not replayed.
+static bool useBatchFrames(uint8_t batchSize) {
+    return batchSize > 1 || (preferences.getUChar("gw_feat", 0) & GATEWAY_FEATURE_BATCH_FRAMES);
+}
+
+// Wipe pairing and all settings, then restart unpaired. Does not return.
+static void factoryReset() {
+    preferences.clear(); // Explicitly clear the 'ae-temp' namespace keys
+    nvs_flash_erase();   // Wipe the underlying partition
+    nvs_flash_init();
+
+    LOG_I("NVS Erased. Restarting...");
+    statusLed.waitIdle(); // Let the confirmation flash finish
+    delay(500);
+    ESP.restart();
+}
+
+// Copies the string value of "key" out of a flat JSON object. False if missing or too long.
+static bool jsonStringField(const char* json, const char* key, char* out, size_t outLen) {
+    const char* p = strstr(json, key);
+    if (!p || !(p = strchr(p + strlen(key), ':'))) {
+        return false;
+    }
+    p++;
+    while (*p == ' ' || *p == '"') p++;
+    const char* end = strchr(p, '"');
+    if (!end || (size_t)(end - p) >= outLen) {
+        return false;
+    }
+    memcpy(out, p, end - p);
+    out[end - p] = '\0';
+    return true;
+}
+
+static bool g_remoteUnpair = false;
+static bool g_remoteIntervalChanged = false;
+static uint32_t g_savedSleepInterval = 0; // Interval in NVS; loop() saves BLE writes that differ
+
+// Applies one gateway config command the way the matching BLE write would
+static uint8_t applyConfigCommand(const struct_message_config_cmd& cmd) {
+    switch (cmd.command) {
+        case CONFIG_CMD_INTERVAL: {
+            uint32_t intervalMs;
+            memcpy(&intervalMs, cmd.value, sizeof(intervalMs));
+            if (intervalMs < 1000 || intervalMs > 24UL * 60 * 60 * 1000) {
+                return CONFIG_STATUS_INVALID; // Always On needs BLE: it drains the battery
+            }
+            preferences.putUInt("sleep_ms", intervalMs);
+            g_savedSleepInterval = intervalMs; // Already saved: no BLE save flash in loop()
+            bleService.setSleepInterval(intervalMs);
+            g_remoteIntervalChanged = true;
+            LOG_I("Remote: Sleep Interval %u ms", intervalMs);
+            return CONFIG_STATUS_OK;
+        }
+        case CONFIG_CMD_DEADBAND: {
+            float deadbandC;
+            uint32_t heartbeatSec;
+            memcpy(&deadbandC, cmd.value, sizeof(deadbandC));
+            memcpy(&heartbeatSec, cmd.value + sizeof(deadbandC), sizeof(heartbeatSec));
+            if (isnan(deadbandC) || deadbandC < 0.0f || deadbandC > 50.0f) {
+                return CONFIG_STATUS_INVALID;
+            }
+            preferences.putFloat("deadband", deadbandC);
+            preferences.putUInt("heartbeat", heartbeatSec);
+            reportPolicy.configure(deadbandC, heartbeatSec);
+            bleService.setReportConfig(deadbandC, heartbeatSec);
+            LOG_I("Remote: Report Config %.2f C / %u s", deadbandC, heartbeatSec);
+            return CONFIG_STATUS_OK;
+        }
+        case CONFIG_CMD_TX_POWER: {
+            linkControl.configure(linkControl.getRateSetting(), linkControl.isLongRange(), (int8_t)cmd.value[0]);
+            int8_t txPower = linkControl.getTxPowerSetting(); // As clamped to the supported range
+            preferences.putChar("tx_pwr", txPower);
+            bleService.setLinkConfig(linkControl.getRateSetting(), linkControl.isLongRange(), txPower);
+            LOG_I("Remote: TX Power %d", txPower);
+            return CONFIG_STATUS_OK;
+        }
+        case CONFIG_CMD_NAME: {
+            char suffix[sizeof(cmd.value) + 1];
+            memcpy(suffix, cmd.value, sizeof(cmd.value));
+            suffix[sizeof(cmd.value)] = '\0';
+            preferences.putString("name", suffix);
+            loadDeviceName();
+            bleService.setName(suffix);
+            LOG_I("Remote: Name Suffix '%s'", suffix);
+            return CONFIG_STATUS_OK;
+        }
+        case CONFIG_CMD_UNPAIR:
+            g_remoteUnpair = true; // After the ack has gone out
+            return CONFIG_STATUS_OK;
+        case CONFIG_CMD_FEATURES:
+            preferences.putUChar("gw_feat", cmd.value[0]);
+            LOG_I("Remote: Gateway Features 0x%02X", cmd.value[0]);
+            return CONFIG_STATUS_OK;
+        default:
+            return CONFIG_STATUS_UNKNOWN;
+    }
+}
+
+// Applies queued gateway commands and acknowledges each one
+static void serviceConfigCommands() {
+    struct_message_config_cmd cmd;
+    while (remoteConfig.pop(cmd)) {
+        struct_message_config_ack ack;
+        ack.messageID = 114;
+        ack.seq = cmd.seq;
+        ack.command = cmd.command;
+        if (remoteConfig.isDuplicate(cmd.seq)) {
+            ack.status = CONFIG_STATUS_OK; // Our previous ack was lost
+        } else {
+            ack.status = applyConfigCommand(cmd);
+            remoteConfig.markApplied(cmd.seq);
+        }
+        espNowService.sendAndWait(g_pairedMac, (const uint8_t*)&ack, sizeof(ack), kUplinkSend);
+    }
+    if (g_remoteUnpair) {
+        LOG_I("Remote Unpair Triggered!");
+        factoryReset();
+    }
+}
+
+void runIndirectOta();
+void enterDeepSleep(uint32_t sleepMs);
+
+// Timer Wake Fast Path: sample, send one frame, sleep.
+// Skips the USB CDC wait and the whole NimBLE stack - BLE only starts on POR/manual wakes.
+// Returns only if the fast path cannot run (e.g. no paired gateway), in which case
+// setup() falls back to the full boot.
+static void runTimerWakeCycle() {
+    uint32_t sleepMs = preferences.getUInt("sleep_ms", DEFAULT_SLEEP_MS);
+    char savedMac[18] = "";
+    char savedKey[33] = "";
+    preferences.getString("p_mac", savedMac, sizeof(savedMac));
+    preferences.getString("p_key", savedKey, sizeof(savedKey));
+    if (sleepMs == 0 || savedMac[0] == '\0' || strlen(savedKey) != 32) {
+        LOG_W("Fast Wake: Not paired or Always On -> Full Boot");
+        return;
+    }
+
+    loadDeviceName();
+
+    tempAlarm.configure(preferences.getFloat("t_low", NAN), preferences.getFloat("t_high", NAN));
+    uint8_t batchSize = preferences.getUChar("batch_n", 1);
+    bool batchFrames = useBatchFrames(batchSize);
+    reportPolicy.configure(preferences.getFloat("deadband", 0.0f), preferences.getUInt("heartbeat", 0));
+    adaptiveScheduler.configure(preferences.getUInt("ad_min", 0), preferences.getUInt("ad_max", 0),
+                                preferences.getUChar("ad_aggr", 0));
+
+    // Radio only comes up when this sample completes a batch (or an alarm needs sending).
+    // When that is known up front the pipeline applies: start the TMP102 conversion, bring
+    // the radio up while it converts, then collect the reading just before the frame is built.
+    // With a deadband the decision waits for the reading, since most samples are dropped.
+    bool flush = g_isAlertWakeup ||
+                 (!reportPolicy.isEnabled() && sampleBuffer.count() + 1 >= batchSize);
+    bool radioUp = false;
+    linkControl.configure(preferences.getUChar("phy_rate", LINK_RATE_AUTO), preferences.getBool("phy_lr", false),
+                          preferences.getChar("tx_pwr", LINK_TXP_AUTO));
+    linkStats.configure(preferences.getUInt("diag_s", DEFAULT_DIAG_SEC));
+    bleBeacon.configure(preferences.getUShort("bcn_ms", 0));
+    auto startRadio = [&]() {
+        espNowService.begin();
+        espNowService.registerRecvCallback(onDataRecv);
+        sscanf(savedMac, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+               &g_pairedMac[0], &g_pairedMac[1], &g_pairedMac[2],
+               &g_pairedMac[3], &g_pairedMac[4], &g_pairedMac[5]);
+        espNowService.addSecurePeer(savedMac, savedKey);
+        espNowService.restoreChannel(preferences.getUChar("gw_ch", 0));
+        if (espNowService.needsSweep()) {
+            findGateway();
+        }
+        radioUp = true;
+        markWakePhase("radio_up");
+    };
+
+    Wire.begin(I2C_SDA, I2C_SCL);
+    bool sensorOk = tmp102.begin(I2C_SDA, I2C_SCL);
+    if (sensorOk && !isAlertWakeArmed()) {
+        // One-shot: sensor stays in shutdown, so no SD write is needed before sleep
+        sensorOk = tmp102.startOneShot();
+#ifdef WAKE_PIPELINE_SEQUENTIAL
+        tmp102.waitForConversion();
+#endif
+    }
+    // ALERT wake armed: the sensor is already converting continuously, the latest result is ready
+    if (!sensorOk) {
+        LOG_E("TMP102 Init Failed!");
+    }
+    markWakePhase("sensor_start");
+
+    if (flush) {
+        startRadio();
+    }
+
+    float temp = NAN;
+    if (sensorOk) {
+        if (!isAlertWakeArmed()) {
+            tmp102.waitForConversion(); // Usually already elapsed behind radio init
+        }
+        temp = tmp102.readTemperature();
+    }
+    markWakePhase("sensor_read");
+
+    // ALERT wake: trust the comparator, otherwise apply the same hysteresis in software
+    bool alarmChanged = g_isAlertWakeup ? tempAlarm.update(tmp102.isAlertActive())
+                                        : tempAlarm.evaluate(temp);
+
+    uint32_t now = SampleBuffer::now();
+    uint32_t seq = logReading(now, temp, tempAlarm.isActive() ? HISTORY_FLAG_ALARM : 0);
+    tempStats.addSample(temp, now, tempAlarm.getHigh());
+    adaptiveScheduler.addSample(temp, now);
+    sleepMs = adaptiveScheduler.nextInterval(sleepMs);
+
+    // Report state only moves once the gateway has ACKed the reading (see below)
+    bool heartbeat = reportPolicy.isHeartbeatDue(now);
+    if (alarmChanged || reportPolicy.shouldReport(temp, now)) {
+        if (batchSize > 1) {
+            sampleBuffer.push(temp, seq);
+        }
+        // Threshold crossings and heartbeats force a flush
+        if (!radioUp && (batchSize <= 1 || alarmChanged || heartbeat || sampleBuffer.count() >= batchSize)) {
+            startRadio();
+        }
+    }
+
+    if (bleBeacon.isEnabled()) {
+        sendBeacon(temp, seq, savedKey);
+    }
+
+    if (!radioUp) {
+        LOG_I("Buffered %u/%u samples, radio stays off", sampleBuffer.count(), batchSize);
+        printWakePhases();
+        enterDeepSleep(sleepMs);
+    }
+
+    // Scheduled uplinks transmit in their slot; alarms go out immediately
+    if (!g_isAlertWakeup) {
+        slotSchedule.waitForSlot();
+    }
+
+    // Gateway RSSI from its replies in the listen window
+    espNowService.setRssiCapture(true);
+
+    // Alarm and telemetry go out back to back, the alarm ACK is collected afterwards
+    EspNowHandle alarmHandle = ESPNOW_NO_HANDLE;
+    if (alarmChanged) {
+        alarmHandle = sendAlarmFrame(temp);
+    }
+
+    bool acked;
+    if (batchSize <= 1) {
+        // The current reading always goes out as the legacy frame every gateway decodes
+        const TempSensorData& data = fillTelemetry(temp, sleepMs);
+        acked = finishSend(espNowService.sendToPeer(data, g_pairedMac), &data, sizeof(data));
+        if (acked) {
+            reportPolicy.markReported(temp, now);
+            if (batchFrames) {
+                uplinkBacklog(sleepMs); // Replay what an outage held back
+            } else {
+                sampleBuffer.clear();
+            }
+            sendStatusFrame(sleepMs, batchFrames); // Separate frame: id 22 stays untouched
+        } else if (batchFrames) {
+            sampleBuffer.push(temp, seq); // Kept for replay once delivery succeeds again
+        }
+    } else {
+        acked = uplinkBacklog(sleepMs);
+    }
+    if (alarmChanged) {
+        finishSend(alarmHandle, &g_alarmFrame, sizeof(g_alarmFrame));
+    }
+    markWakePhase("send_ack");
+    if (acked) {
+        // Gateway pushes OTA triggers and config right after our uplink (JIT delivery).
+        // The window only stretches while the gateway flags more commands.
+        xEventGroupClearBits(g_loopEvents, LOOP_EVT_ESPNOW | LOOP_EVT_OTA);
+        remoteConfig.openWindow(TIMER_WAKE_LISTEN_MS);
+        while (!g_indirectOtaPending && remoteConfig.isWindowOpen()) {
+            serviceConfigCommands();
+            // Blocks until the gateway sends something or the (possibly extended) window ends
+            xEventGroupWaitBits(g_loopEvents, LOOP_EVT_ESPNOW | LOOP_EVT_OTA, pdTRUE, pdFALSE,
+                                pdMS_TO_TICKS(remoteConfig.remainingMs()));
         }
+        markWakePhase("listen");
+        if (g_remoteIntervalChanged && !adaptiveScheduler.isEnabled()) {
+            sleepMs = preferences.getUInt("sleep_ms", sleepMs);
+        }
+    }
+    espNowService.setRssiCapture(false);
+
+    if (g_indirectOtaPending) {
+        g_indirectOtaPending = false;
+        runIndirectOta(); // Does not return
     }
+
+    saveGatewayChannel();
+    printWakePhases();
+    enterDeepSleep(sleepMs);
 }
 
 void setup() {
-    Serial.begin(115200);
-    // Wait a bit for serial if USB connected
-    delay(1000); 
-    Serial.println("AE Temp Sensor Starting...");
-    
+    markWakeStart();
+    esp_sleep_wakeup_cause_t wakeCause = esp_sleep_get_wakeup_cause();
+    bool fastWake = wakeCause == ESP_SLEEP_WAKEUP_TIMER || wakeCause == ESP_SLEEP_WAKEUP_GPIO;
+    bool serialLog = !fastWake || LOG_TIMER_WAKE_SERIAL;
+    if (serialLog) {
+        Serial.begin(115200);
+    }
+    logger.begin(serialLog);
+
     gpio_hold_dis((gpio_num_t)NEOPIXEL_PWR);
     gpio_hold_dis((gpio_num_t)NEOPIXEL_DATA); // Release Data Pin Hold
     gpio_deep_sleep_hold_dis(); 
@@ -73,117 +858,108 @@ void setup() {
     // Init Boot Pin
     pinMode(BOOT_PIN, INPUT_PULLUP);
 
+    // Init NVS
+    preferences.begin("ae-temp", false);
+
+    // Event-driven waits: radio and BLE callbacks wake loop() and the timer-wake listen window
+    g_loopEvents = xEventGroupCreateStatic(&s_loopEventsBuffer);
+
     // Check Wakeup Cause
-    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
+    if (fastWake) {
         g_isTimerWakeup = true;
-        Serial.println("Wakeup: TIMER (Fast Sleep Mode)");
-    } else {
-        Serial.println("Wakeup: MANUAL/POWER (POR) -> Staying Awake 30s");
+        g_isAlertWakeup = (wakeCause == ESP_SLEEP_WAKEUP_GPIO);
+        LOG_I("%s", g_isAlertWakeup ? "Wakeup: TMP102 ALERT (Fast Sleep Mode)"
+                                    : "Wakeup: TIMER (Fast Sleep Mode)");
+        runTimerWakeCycle(); // Sleeps on success
+        if (!serialLog) {
+            Serial.begin(115200); // Full boot after all: logs go to serial again
+            logger.begin(true);
+        }
+    }
+
+    // Wait a bit for serial if USB connected
+    delay(1000); 
+    LOG_I("AE Temp Sensor Starting...");
+
+    if (!g_isTimerWakeup) {
+        LOG_I("Wakeup: MANUAL/POWER (POR) -> Staying Awake 30s");
         isStayingAwake = true; // Ensure 30s awake window on boot/manual reset
     }
 
-    // Init NVS
-    preferences.begin("ae-temp", false);
     uint32_t sleepInterval = preferences.getUInt("sleep_ms", DEFAULT_SLEEP_MS);
     
     // Load Name Suffix (previously "name")
-    String nameSuffix = preferences.getString("name", ""); 
-    Serial.printf("DEBUG: Loaded Name Suffix from NVS: '%s'\n", nameSuffix.c_str());
-    
-    String deviceName = "AE Temp Sensor";
-    if (nameSuffix.length() > 0) {
-        deviceName += " - " + nameSuffix;
-    }
-    Serial.printf("DEBUG: Full Device Name for BLE: '%s'\n", deviceName.c_str());
+    char nameSuffix[NAME_SUFFIX_MAX] = "";
+    preferences.getString("name", nameSuffix, sizeof(nameSuffix));
+    LOG_D("DEBUG: Loaded Name Suffix from NVS: '%s'", nameSuffix);
+    loadDeviceName();
+    LOG_D("DEBUG: Full Device Name for BLE: '%s'", g_deviceName);
     
     bleService.setSleepInterval(sleepInterval);
+    g_savedSleepInterval = sleepInterval;
     bleService.setNameCallback([](const char* suffix) {
         // Save only the suffix
         preferences.putString("name", suffix);
-        Serial.printf("Saved new name suffix to NVS: %s\n", suffix);
+        g_nameChanged = true; // loop() rebuilds the frame template
+        LOG_I("Saved new name suffix to NVS: %s", suffix);
     });
 
     bool isPaired = preferences.getBool("paired", false);
     bleService.setPaired(isPaired);
     bleService.setPairedCallback([](bool paired) {
         preferences.putBool("paired", paired);
-        Serial.printf("Saved Paired Status to NVS: %s\n", paired ? "True" : "False");
+        LOG_I("Saved Paired Status to NVS: %s", paired ? "True" : "False");
         statusLed.flash(0, 128, 0, 500); // Green confirmation (Dimmed)
         
         if (!paired) {
-            Serial.println("Factory Reset/Unpair Triggered!");
+            LOG_I("Factory Reset/Unpair Triggered!");
             // Visual confirmation: Long Red Flash
             statusLed.flash(255, 0, 0, 1000); 
             
             // Wipe Everything
-            preferences.clear(); // Explicitly clear the 'ae-temp' namespace keys
-            nvs_flash_erase();   // Wipe the underlying partition
-            nvs_flash_init();
-            
-            Serial.println("NVS Erased. Restarting...");
-            delay(500);
-            ESP.restart();
+            factoryReset();
         }
     });
     
     // Handle JSON Pairing Data {"gauge_mac":"...", "key":"..."}
     bleService.setPairingDataCallback([](const char* json) {
-        Serial.printf("Processing Pairing JSON/CMD: %s\n", json);
+        LOG_I("Processing Pairing JSON/CMD: %s", json);
         
-        if (String(json) == "PAIRING") {
-            Serial.println("Received PAIRING command via BLE. Forcing broadcast mode for 5 mins.");
+        if (strcmp(json, "PAIRING") == 0) {
+            LOG_I("Received PAIRING command via BLE. Forcing broadcast mode for 5 mins.");
             espNowService.setForceBroadcast(true);
             // We use a global or local static to track time
             return;
         }
 
-        // Minimal JSON parsing to avoid heavy library usage if possible, or use ArduinoJson if available (user has it in other projects)
-        // Let's assume ArduinoJson is available or use String search
-        String j = String(json);
-        
-        // Extract MAC
-        int macIdx = j.indexOf("gauge_mac");
-        String gaugeMacStr = "";
-        if (macIdx > 0) {
-            int start = j.indexOf(":", macIdx) + 1;
-            // Skip quotes
-            while (j[start] == ' ' || j[start] == '"') start++;
-            int end = j.indexOf('"', start);
-            gaugeMacStr = j.substring(start, end);
-        }
-        
-        // Extract Key
-        int keyIdx = j.indexOf("key");
-        String keyStr = "";
-        if (keyIdx > 0) {
-            int start = j.indexOf(":", keyIdx) + 1;
-            while (j[start] == ' ' || j[start] == '"') start++;
-            int end = j.indexOf('"', start);
-            keyStr = j.substring(start, end);
-        }
+        // Minimal in-place JSON field extraction, no heap
+        char gaugeMacStr[18];
+        char keyStr[33];
+        bool haveMac = jsonStringField(json, "gauge_mac", gaugeMacStr, sizeof(gaugeMacStr));
+        bool haveKey = jsonStringField(json, "key", keyStr, sizeof(keyStr));
         
-        Serial.printf("Extracted MAC: %s, Key: %s\n", gaugeMacStr.c_str(), keyStr.c_str());
+        LOG_I("Extracted MAC: %s", haveMac ? gaugeMacStr : "-");
         
-        if (gaugeMacStr.length() > 0 && keyStr.length() == 32) {
+        if (haveMac && haveKey && strlen(keyStr) == 32) {
              preferences.putString("p_mac", gaugeMacStr);
              preferences.putString("p_key", keyStr);
              
              // Update Global MAC for main loop
-             sscanf(gaugeMacStr.c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", 
+             sscanf(gaugeMacStr, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", 
                &g_pairedMac[0], &g_pairedMac[1], &g_pairedMac[2], 
                &g_pairedMac[3], &g_pairedMac[4], &g_pairedMac[5]);
              
              // Update runtime peer immediately
-             espNowService.addSecurePeer(gaugeMacStr.c_str(), keyStr.c_str());
+             espNowService.addSecurePeer(gaugeMacStr, keyStr);
              
              bleService.updatePaired(true); // Notify App success
         } else {
-            Serial.println("Invalid Pairing Data");
+            LOG_E("Invalid Pairing Data");
         }
     });
 
     bleService.setWifiCallback([](const char* ssid, const char* pass) {
-        Serial.printf("Received WiFi Creds via BLE: SSID='%s'\n", ssid);
+        LOG_I("Received WiFi Creds via BLE: SSID='%s'", ssid);
         // Store in global trigger struct for upcoming OTA
         memset(&g_otaTrigger, 0, sizeof(g_otaTrigger)); // Clear first to avoid garbage
         g_otaTrigger.messageID = 110;
@@ -193,12 +969,12 @@ void setup() {
     });
 
     bleService.setForceOtaCallback([]() {
-        Serial.println("FORCE OTA Triggered via Direct BLE!");
+        LOG_I("FORCE OTA Triggered via Direct BLE!");
         // We assume WiFi creds were just sent.
         // If not, we might fail to connect.
         // Check if SSID is present?
         if (strlen(g_otaTrigger.ssid) == 0) {
-             Serial.println("Aborting Force OTA: No WiFi SSID set.");
+             LOG_E("Aborting Force OTA: No WiFi SSID set.");
              return;
         }
 
@@ -207,16 +983,95 @@ void setup() {
         // URL left empty -> triggers OTA::isUpdateAvailable() logic in loop()
         
         g_indirectOtaPending = true;
+        signalLoop(LOOP_EVT_OTA);
+    });
+
+    tempAlarm.configure(preferences.getFloat("t_low", NAN), preferences.getFloat("t_high", NAN));
+    bleService.setAlarmThresholds(tempAlarm.getLow(), tempAlarm.getHigh());
+    bleService.setAlarmCallback([](float low, float high) {
+        preferences.putFloat("t_low", low);
+        preferences.putFloat("t_high", high);
+        tempAlarm.configure(low, high);
+        applyAlarmConfig();
+    });
+
+    bleService.setBatchSize(preferences.getUChar("batch_n", 1));
+    bleService.setBatchSizeCallback([](uint8_t size) {
+        preferences.putUChar("batch_n", size);
+        LOG_I("Saved Batch Size to NVS: %u", size);
+    });
+
+    reportPolicy.configure(preferences.getFloat("deadband", 0.0f), preferences.getUInt("heartbeat", 0));
+    bleService.setReportConfig(reportPolicy.getDeadband(), reportPolicy.getHeartbeat());
+    bleService.setReportCallback([](float deadbandC, uint32_t heartbeatSec) {
+        preferences.putFloat("deadband", deadbandC);
+        preferences.putUInt("heartbeat", heartbeatSec);
+        reportPolicy.configure(deadbandC, heartbeatSec);
+        LOG_I("Saved Report Config to NVS: %.2f C / %u s", deadbandC, heartbeatSec);
+    });
+
+    adaptiveScheduler.configure(preferences.getUInt("ad_min", 0), preferences.getUInt("ad_max", 0),
+                                preferences.getUChar("ad_aggr", 0));
+    bleService.setAdaptiveConfig(adaptiveScheduler.getMin(), adaptiveScheduler.getMax(),
+                                 adaptiveScheduler.getAggressiveness());
+    bleService.setAdaptiveCallback([](uint32_t minMs, uint32_t maxMs, uint8_t aggressiveness) {
+        preferences.putUInt("ad_min", minMs);
+        preferences.putUInt("ad_max", maxMs);
+        preferences.putUChar("ad_aggr", aggressiveness);
+        adaptiveScheduler.configure(minMs, maxMs, aggressiveness);
+        LOG_I("Saved Adaptive Config to NVS: %u-%u ms x%u", minMs, maxMs, aggressiveness);
+    });
+
+    linkControl.configure(preferences.getUChar("phy_rate", LINK_RATE_AUTO), preferences.getBool("phy_lr", false),
+                          preferences.getChar("tx_pwr", LINK_TXP_AUTO));
+    bleService.setLinkConfig(linkControl.getRateSetting(), linkControl.isLongRange(), linkControl.getTxPowerSetting());
+    bleService.setLinkCallback([](uint8_t rate, bool longRange, int8_t txPower) {
+        preferences.putUChar("phy_rate", rate);
+        preferences.putBool("phy_lr", longRange);
+        preferences.putChar("tx_pwr", txPower);
+        linkControl.configure(rate, longRange, txPower);
+        linkControl.begin(); // Protocol change applies immediately
+        LOG_I("Saved Link Config to NVS: %s, LR %s, TX %d", LinkControl::rateName(rate),
+                      longRange ? "on" : "off", txPower);
+    });
+
+    linkStats.configure(preferences.getUInt("diag_s", DEFAULT_DIAG_SEC));
+    bleService.setDiagInterval(linkStats.getReportInterval());
+    bleService.setDiagCallback([](uint32_t seconds) {
+        preferences.putUInt("diag_s", seconds);
+        linkStats.configure(seconds);
+        LOG_I("Saved Diagnostics Cadence to NVS: %u s", seconds);
+    });
+
+    bleBeacon.configure(preferences.getUShort("bcn_ms", 0));
+    bleService.setBeaconBurst(bleBeacon.getBurstMs());
+    bleService.setBeaconCallback([](uint16_t burstMs) {
+        preferences.putUShort("bcn_ms", burstMs);
+        bleBeacon.configure(burstMs);
+        LOG_I("Saved Beacon Burst to NVS: %u ms", burstMs);
     });
 
     // Init Drivers
     Wire.begin(I2C_SDA, I2C_SCL); // Init Wire before TMP102
     if (!tmp102.begin(I2C_SDA, I2C_SCL)) {
-        Serial.println("TMP102 Init Failed!");
+        LOG_E("TMP102 Init Failed!");
     } else {
-        tmp102.wakeup(); // Ensure continuous conversion mode
-        delay(35);       // Allow time for first conversion (26ms typical)
+#ifdef TMP102_CALIBRATION_STREAM
+        tmp102.setConversionRate(TMP102::RATE_8HZ);
+#else
+        // Always On units only read every few seconds: 0.25Hz cuts sensor current ~10x
+        tmp102.setConversionRate(sleepInterval == 0 ? TMP102::RATE_0_25HZ : TMP102::RATE_4HZ);
+#endif
+#ifdef TMP102_EXTENDED_MODE
+        tmp102.setExtendedMode(true);
+#endif
+        applyAlarmConfig();
+        tmp102.wakeup(); // Ensure continuous conversion mode (first result lands while radios init)
+#ifdef WAKE_PIPELINE_SEQUENTIAL
+        tmp102.waitForConversion();
+#endif
     }
+    markWakePhase("sensor_start");
     
     statusLed.begin();
     statusLed.begin();
@@ -224,47 +1079,58 @@ void setup() {
 
     // Load Paired MAC if exists - MOVED down after begin()
 
+    bleService.setActivityCallback([]() { signalLoop(LOOP_EVT_BLE); });
+
     // Init Services
     espNowService.begin();
     espNowService.registerRecvCallback(onDataRecv);
-    bleService.begin(deviceName.c_str());
+    markWakePhase("radio_up");
+    bleService.begin(g_deviceName);
     // Ensure the characteristic holds only the suffix for editing
-    bleService.updateName(nameSuffix.c_str());
+    bleService.updateName(nameSuffix);
     
     // Load Paired MAC if exists (MUST be after espNowService.begin)
-    String savedMac = preferences.getString("p_mac", "");
-    if (savedMac.length() > 0) {
-        sscanf(savedMac.c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", 
+    char savedMac[18] = "";
+    preferences.getString("p_mac", savedMac, sizeof(savedMac));
+    if (savedMac[0] != '\0') {
+        sscanf(savedMac, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", 
                &g_pairedMac[0], &g_pairedMac[1], &g_pairedMac[2], 
                &g_pairedMac[3], &g_pairedMac[4], &g_pairedMac[5]);
         
-        String savedKey = preferences.getString("p_key", "");
-        if (savedKey.length() == 32) {
-             espNowService.addSecurePeer(savedMac.c_str(), savedKey.c_str());
+        char savedKey[33] = "";
+        preferences.getString("p_key", savedKey, sizeof(savedKey));
+        if (strlen(savedKey) == 32) {
+             espNowService.addSecurePeer(savedMac, savedKey);
+             espNowService.restoreChannel(preferences.getUChar("gw_ch", 0));
+             if (espNowService.needsSweep()) {
+                 findGateway();
+             }
         }
     }
     
     // Ensure Paired Char has correct MAC (Redundant if set in begin, but safe)
     // bleService update handled in begin()
 
+    markWakePhase("ble_up");
+
     // Read Sensors
+    tmp102.waitForConversion();
     float temp = tmp102.readTemperature();
-    Serial.printf("Temperature: %.2f C\n", temp);
+    markWakePhase("sensor_read");
+    adaptiveScheduler.addSample(temp, SampleBuffer::now());
+    tempStats.addSample(temp, SampleBuffer::now(), tempAlarm.getHigh());
+    uint32_t seq = logReading(SampleBuffer::now(), temp, 0);
+    LOG_I("Temperature: %.2f C", temp);
     
-    // Reset Send Status before sending
-    espNowService.resetSendStatus();
+    // Alarm and telemetry go out back to back, the alarm ACK is collected afterwards
+    bool alarmChanged = tempAlarm.evaluate(temp) && bleService.isPaired();
+    EspNowHandle alarmHandle = ESPNOW_NO_HANDLE;
+    if (alarmChanged) {
+        alarmHandle = sendAlarmFrame(temp);
+    }
 
     // Broadcast ESPNow
-    TempSensorData data;
-    data.id = 22;
-    data.temperature = temp;
-    data.batteryVoltage = 3.3; // Placeholder
-    data.batteryLevel = 100;   // Placeholder
-    data.updateInterval = bleService.getSleepInterval();
-    data.hardwareVersion = HW_VERSION;
-    strncpy(data.firmwareVersion, String(OTA_VERSION).c_str(), sizeof(data.firmwareVersion) - 1);
-    memset(data.name, 0, sizeof(data.name));
-    strncpy(data.name, deviceName.c_str(), sizeof(data.name) - 1);
+    const TempSensorData& data = fillTelemetry(temp, bleService.getSleepInterval());
 
     // Send Data (Unicast if Paired, Broadcast if Not)
     bool isPairedLocal = bleService.isPaired(); 
@@ -274,76 +1140,105 @@ void setup() {
     }
 
     if (isPairedLocal) {
-         espNowService.sendToPeer(data, g_pairedMac);
-    } else {
-         espNowService.broadcast(data);
-         statusLed.flash(64, 64, 64, 50); // White Flash (Broadcast/Discovery)
-    }
-
-    // WAIT FOR SEND FINISH (Essential for Fast Sleep)
-    unsigned long sendStart = millis();
-    while (!espNowService.sendFinished && (millis() - sendStart < 100)) {
-        delay(1);
-    }
-    
-    if (espNowService.sendFinished) {
-         if (espNowService.sendSuccess) {
-             delay(5); // success, small buffer
+         bool acked = finishSend(espNowService.sendToPeer(data, g_pairedMac), &data, sizeof(data));
+         if (alarmChanged) {
+             finishSend(alarmHandle, &g_alarmFrame, sizeof(g_alarmFrame));
+         }
+         bool batchFrames = useBatchFrames(preferences.getUChar("batch_n", 1));
+         if (acked) {
+             reportPolicy.markReported(temp, SampleBuffer::now());
+             if (batchFrames) {
+                 uplinkBacklog(bleService.getSleepInterval()); // Gateway is back: replay what it missed
+             }
+             sendStatusFrame(bleService.getSleepInterval(), batchFrames);
          } else {
-             Serial.println("ESP-NOW Send Failed!");
              statusLed.flash(255, 128, 0, 50); // Orange Flash (Send Fail)
+             if (batchFrames) {
+                 sampleBuffer.push(temp, seq); // Kept for replay once delivery succeeds again
+             }
          }
     } else {
-         Serial.println("ESP-NOW Send Timeout!");
+         espNowService.broadcast(data);
+         statusLed.flash(64, 64, 64, 50); // White Flash (Broadcast/Discovery)
     }
+    markWakePhase("send_ack");
+    saveGatewayChannel();
+    printWakePhases();
 
     // Update BLE
     bleService.updateTemperature(temp);
     bleService.updateBatteryLevel(100);
 
+    const esp_timer_create_args_t sampleTimerArgs = {
+        .callback = [](void*) { signalLoop(LOOP_EVT_SAMPLE); },
+        .arg = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "awake_sample",
+        .skip_unhandled_events = true,
+    };
+    if (esp_timer_create(&sampleTimerArgs, &g_sampleTimer) == ESP_OK) {
+        esp_timer_start_periodic(g_sampleTimer, AWAKE_SAMPLE_MS * 1000ULL);
+    }
+
+    setCpuFrequencyMhz(AWAKE_CPU_MHZ);
+
     stateStartTime = millis();
 }
 
+// How long loop() may block: until the awake window can close, the next LED heartbeat,
+// or a short poll while a history download is streaming (notify credits free up
+// without an event, and a zero wait would spin the CPU)
+static uint32_t loopWaitMs() {
+    if (bleService.isHistoryStreaming()) {
+        return LOOP_STREAM_POLL_MS;
+    }
+    uint32_t waitMs = LOOP_IDLE_MAX_MS;
+    if (bleService.isPaired() && !isStayingAwake) {
+        uint32_t awakeWindow = g_isTimerWakeup ? 200 : AWAKE_TIME_MS;
+        uint32_t elapsed = millis() - stateStartTime;
+        if (elapsed < awakeWindow && awakeWindow - elapsed < waitMs) {
+            waitMs = awakeWindow - elapsed + 1;
+        }
+    }
+    return waitMs;
+}
+
 // Include ESP WiFi for channel switching
 #include <esp_wifi.h>
 
 void loop() {
+    // Blocks until an event or the next deadline
+    EventBits_t events = xEventGroupWaitBits(g_loopEvents, LOOP_EVT_ALL, pdTRUE, pdFALSE,
+                                             pdMS_TO_TICKS(loopWaitMs()));
+
     // Check for sleep interval change from BLE
-    static uint32_t lastSleepInterval = bleService.getSleepInterval();
-    if (bleService.getSleepInterval() != lastSleepInterval) {
-        lastSleepInterval = bleService.getSleepInterval();
-        preferences.putUInt("sleep_ms", lastSleepInterval);
-        Serial.println("Saved new sleep interval to NVS");
+    if (bleService.getSleepInterval() != g_savedSleepInterval) {
+        g_savedSleepInterval = bleService.getSleepInterval();
+        preferences.putUInt("sleep_ms", g_savedSleepInterval);
+        LOG_I("Saved new sleep interval to NVS");
         statusLed.flash(0, 0, 128, 200); // Blue flash on save (Dimmed)
     }
 
+    if (events & LOOP_EVT_ESPNOW) {
+        serviceConfigCommands(); // Gateway commands arriving while awake
+    }
+
     // BLE Maintenance
     if (bleService.isConnected()) {
         isStayingAwake = true;
+        bleService.serviceHistoryStream();
         
-        static unsigned long lastUpdate = 0;
-        if (millis() - lastUpdate > 5000) {
+        if (events & LOOP_EVT_SAMPLE) {
             float temp = tmp102.readTemperature();
             bleService.updateTemperature(temp);
             
             // Broadcast ESP-NOW Data so Gauge can see it during pairing
             // CYCLE CHANNELS to ensure Gauge finds us regardless of its WiFi channel
-            TempSensorData data;
-            data.id = 22; 
-            data.temperature = temp;
-            data.batteryVoltage = 3.3; 
-            data.batteryLevel = 100;
-            data.updateInterval = 5000; // 5 seconds when connected/awake
-            data.hardwareVersion = HW_VERSION;
-            strncpy(data.firmwareVersion, String(OTA_VERSION).c_str(), sizeof(data.firmwareVersion) - 1);
-
-            String suffix = preferences.getString("name", "");
-            String nameForEspNow = "AE Temp Sensor";
-            if (suffix.length() > 0) nameForEspNow += " - " + suffix;
-            
-            // Start with Generic Broadcast Address
-            memset(data.name, 0, sizeof(data.name));
-            strncpy(data.name, nameForEspNow.c_str(), sizeof(data.name) - 1);
+            if (g_nameChanged) {
+                g_nameChanged = false;
+                loadDeviceName();
+            }
+            const TempSensorData& data = fillTelemetry(temp, AWAKE_SAMPLE_MS);
 
             // If Paired, send unicast to Gauge Address (Secure Peer)
             // If Not Paired, broadcast to FF:FF... on all channels
@@ -352,7 +1247,7 @@ void loop() {
             // Robustness: If NVS or Flag is wrong, check if we have the peer loaded (and Global Mac set)
             if (!isPaired && (g_pairedMac[0] != 0 || g_pairedMac[1] != 0)) {
                  if (esp_now_is_peer_exist(g_pairedMac)) {
-                     Serial.println("DEBUG: isPaired flag was false, but Secure Peer exists. Forcing Paired Mode.");
+                     LOG_D("DEBUG: isPaired flag was false, but Secure Peer exists. Forcing Paired Mode.");
                      isPaired = true;
                      bleService.setPaired(true); // Sync flag
                  }
@@ -362,39 +1257,32 @@ void loop() {
                  // UNICAST ENCRYPTED to GAUGE (or Broadcast if forced)
                  if (espNowService.isForceBroadcast()) {
                       // Forced Broadcast during Pairing
-                      Serial.println("PAIRING MODE: Sending Broadcast Burst...");
+                      LOG_I("PAIRING MODE: Sending Broadcast Burst...");
                       statusLed.flash(0, 0, 128, 50); 
-                      for (int ch = 1; ch <= 13; ch++) {
-                         esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);
-                         delay(10); 
-                         espNowService.broadcast(data);
-                      }
-                      esp_wifi_set_channel(1, WIFI_SECOND_CHAN_NONE);
+                      espNowService.broadcastDiscovery(data, true); // New gauge may be on any channel
                       
                       static unsigned long pairingStartTime = millis();
                       if (millis() - pairingStartTime > 300000) {
-                          Serial.println("Pairing Mode Timeout (5 mins).");
+                          LOG_W("Pairing Mode Timeout (5 mins).");
                           espNowService.setForceBroadcast(false);
                       }
                  }
                  
                  if (isPaired) {
-                      espNowService.sendToPeer(data, g_pairedMac);
+                      if (espNowService.needsSweep()) {
+                          espNowService.sweepForPeer((uint8_t*)&data, sizeof(data), g_pairedMac);
+                      } else {
+                          espNowService.release(espNowService.sendToPeer(data, g_pairedMac));
+                      }
                       statusLed.flash(0, 128, 0, 50); // Green Flash on Unicast (Dimmed)
                  }
             } else {
                  // BROADCAST Cycling (Hunt for Gauge)
                  // Only needed during initial discovery when NOT paired
                  statusLed.flash(0, 0, 128, 50); // Blue Flash on Broadcast Burst (Dimmed)
-                 for (int ch = 1; ch <= 13; ch++) {
-                    esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);
-                    delay(10); 
-                    espNowService.broadcast(data);
-                 }
-                 esp_wifi_set_channel(1, WIFI_SECOND_CHAN_NONE);
+                 espNowService.broadcastDiscovery(data);
             }
-            
-            lastUpdate = millis();
+            saveGatewayChannel();
         }
     } else {
         isStayingAwake = false;
@@ -409,71 +1297,15 @@ void loop() {
             
             // Only sleep if interval is > 0. If 0, we stay awake (Always On).
             if (sleepMs > 0) {
-                Serial.printf("Going to sleep for %u ms...\n", sleepMs);
-                statusLed.off();
-                // Shutdown Sensor
-                if (!tmp102.shutdown()) {
-                    Serial.println("TMP102 Shutdown Failed!");
-                    statusLed.flash(255, 0, 0, 50); // Red Flash
-                }
-                
-                // --- PHANTOM POWER FIX ---
-                // Drive Data Pin LOW and Hold it to prevent leakage into LED
-                pinMode(NEOPIXEL_DATA, OUTPUT);
-                digitalWrite(NEOPIXEL_DATA, LOW);
-                gpio_hold_en((gpio_num_t)NEOPIXEL_DATA);
-
-                // Hold NeoPixel Power LOW
-                gpio_hold_en((gpio_num_t)NEOPIXEL_PWR);
-                gpio_deep_sleep_hold_en(); // Enable Global Hold Logic
-                
-                // --- I2C BUS RECOVERY & LEAKAGE FIX ---
-                Wire.end(); // Stop I2C Driver
-                
-                // Manual Bus Clear: Toggle SCL 9 times to unstick slave
-                pinMode(I2C_SDA, INPUT_PULLUP);
-                pinMode(I2C_SCL, OUTPUT);
-                for (int i = 0; i < 9; i++) {
-                    digitalWrite(I2C_SCL, HIGH);
-                    delayMicroseconds(5);
-                    digitalWrite(I2C_SCL, LOW);
-                    delayMicroseconds(5);
-                }
-                // Stop Condition (SDA Low -> High while SCL High)
-                pinMode(I2C_SDA, OUTPUT);
-                digitalWrite(I2C_SDA, LOW);
-                delayMicroseconds(5);
-                digitalWrite(I2C_SCL, HIGH);
-                delayMicroseconds(5);
-                digitalWrite(I2C_SDA, HIGH);
-                delayMicroseconds(5);
-
-                // Final State: Input Pullup (High-Z + Pullup)
-                pinMode(I2C_SDA, INPUT_PULLUP);
-                pinMode(I2C_SCL, INPUT_PULLUP); 
-
-                // --- GPIO WAKEUP FIX ---
-                // Explicitly valid input config for Deep Sleep (AFTER Reset)
-                gpio_config_t io_conf = {};
-                io_conf.intr_type = GPIO_INTR_DISABLE;
-                io_conf.mode = GPIO_MODE_INPUT;
-                io_conf.pin_bit_mask = (1ULL << BOOT_PIN);
-                io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
-                io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
-                gpio_config(&io_conf);
-
-                // --- DEEP SLEEP START ---
-                // Note: GPIO9 (Boot) is NOT an RTC pin on C3, so we cannot wake from it in Deep Sleep.
-                // We only wake on Timer.
-                
-                uint64_t sleepUs = (uint64_t)sleepMs * 1000ULL;
-                esp_sleep_enable_timer_wakeup(sleepUs);
-                esp_deep_sleep_start();
+                enterDeepSleep(adaptiveScheduler.nextInterval(sleepMs));
             } else {
                  // Optional: Periodic debug to confirm we are awake
                  static unsigned long lastAwakeLog = 0;
                  if (millis() - lastAwakeLog > 10000) {
-                     Serial.println("Always On Mode: Staying Awake...");
+                     // Free vs largest block shows fragmentation over long uptimes
+                     LOG_I("Always On Mode: Staying Awake... heap %u free, %u largest",
+                           (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+                           (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
                      lastAwakeLog = millis();
                  }
             }
@@ -481,7 +1313,7 @@ void loop() {
     } else {
         // Not Paired: Stay Awake, Blue heartbeat to indicate "Ready to Pair"
         static unsigned long lastFlash = 0;
-        if (millis() - lastFlash > 2000) {
+        if (millis() - lastFlash >= 2000) {
              statusLed.flash(0, 0, 25, 100); // Faint Blue (Dimmed from 50)
              lastFlash = millis();
         }
@@ -490,69 +1322,140 @@ void loop() {
     // OTA Execution Logic
     if (g_indirectOtaPending) {
         g_indirectOtaPending = false;
-        Serial.println("[OTA] Starting Update Process...");
-        
-        statusLed.flash(0, 0, 255, 500); // Blue Long Flash
-        
-        WiFi.disconnect(true);
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(g_otaTrigger.ssid, g_otaTrigger.pass);
-        
-        int tries = 0;
-        while (WiFi.status() != WL_CONNECTED && tries < 30) {
-            delay(500);
-            tries++;
-            Serial.print(".");
-        }
+        runIndirectOta();
+    }
+}
+
+// Park sensor, LED and I2C bus in their lowest-leakage state and deep sleep. Does not return.
+void enterDeepSleep(uint32_t sleepMs) {
+    // Stretch for the slow clock's measured error, then land on our uplink slot, if assigned
+    sleepMs = slotSchedule.alignSleep(clockCal.toLocalMs(sleepMs));
+    LOG_I("Going to sleep for %u ms...", sleepMs);
+    statusLed.off();
+    // Shutdown Sensor (unless it has to keep converting to drive ALERT)
+    if (!isAlertWakeArmed() && !tmp102.shutdown()) {
+        LOG_E("TMP102 Shutdown Failed!");
+        statusLed.flash(255, 0, 0, 50); // Red Flash
+        statusLed.waitIdle(); // Rail must be off before the pins are held
+    }
+    
+    // --- PHANTOM POWER FIX ---
+    // Drive Data Pin LOW and Hold it to prevent leakage into LED
+    pinMode(NEOPIXEL_DATA, OUTPUT);
+    digitalWrite(NEOPIXEL_DATA, LOW);
+    gpio_hold_en((gpio_num_t)NEOPIXEL_DATA);
+
+    // Hold NeoPixel Power LOW
+    gpio_hold_en((gpio_num_t)NEOPIXEL_PWR);
+    gpio_deep_sleep_hold_en(); // Enable Global Hold Logic
+    
+    // --- I2C BUS RECOVERY & LEAKAGE FIX ---
+    Wire.end(); // Stop I2C Driver
+    
+    // Manual Bus Clear: Toggle SCL 9 times to unstick slave
+    pinMode(I2C_SDA, INPUT_PULLUP);
+    pinMode(I2C_SCL, OUTPUT);
+    for (int i = 0; i < 9; i++) {
+        digitalWrite(I2C_SCL, HIGH);
+        delayMicroseconds(5);
+        digitalWrite(I2C_SCL, LOW);
+        delayMicroseconds(5);
+    }
+    // Stop Condition (SDA Low -> High while SCL High)
+    pinMode(I2C_SDA, OUTPUT);
+    digitalWrite(I2C_SDA, LOW);
+    delayMicroseconds(5);
+    digitalWrite(I2C_SCL, HIGH);
+    delayMicroseconds(5);
+    digitalWrite(I2C_SDA, HIGH);
+    delayMicroseconds(5);
+
+    // Final State: Input Pullup (High-Z + Pullup)
+    pinMode(I2C_SDA, INPUT_PULLUP);
+    pinMode(I2C_SCL, INPUT_PULLUP); 
+
+    // --- GPIO WAKEUP FIX ---
+    // Explicitly valid input config for Deep Sleep (AFTER Reset)
+    gpio_config_t io_conf = {};
+    io_conf.intr_type = GPIO_INTR_DISABLE;
+    io_conf.mode = GPIO_MODE_INPUT;
+    io_conf.pin_bit_mask = (1ULL << BOOT_PIN);
+    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
+    gpio_config(&io_conf);
+
+    // --- DEEP SLEEP START ---
+    // Note: GPIO9 (Boot) is NOT an RTC pin on C3, so we cannot wake from it in Deep Sleep.
+    // We wake on Timer, plus TMP102 ALERT when a threshold alarm is armed and routed.
+    tempAlarm.armWakeup(TMP102_ALERT_PIN);
+    
+    uint64_t sleepUs = (uint64_t)sleepMs * 1000ULL;
+    esp_sleep_enable_timer_wakeup(sleepUs);
+    logger.flush(); // Queued lines would be lost with RAM
+    esp_deep_sleep_start();
+}
+
+// Join WiFi with the stored trigger credentials and run the update. Always restarts.
+void runIndirectOta() {
+    LOG_I("[OTA] Starting Update Process...");
+    
+    statusLed.flash(0, 0, 255, 500); // Blue Long Flash
+    
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(g_otaTrigger.ssid, g_otaTrigger.pass);
+    
+    int tries = 0;
+    while (WiFi.status() != WL_CONNECTED && tries < 30) {
+        delay(500);
+        tries++;
+    }
+    
+    if (WiFi.status() == WL_CONNECTED) {
+        LOG_I("[OTA] WiFi Connected. Syncing Time...");
+        configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+        delay(2000); 
         
-        if (WiFi.status() == WL_CONNECTED) {
-            Serial.println("\n[OTA] WiFi Connected. Syncing Time...");
-            configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-            delay(2000); 
+        WiFiClientSecure client;
+        client.setCACert(OTAGH_CA_CERT);
+        OTA::init(client);
+
+        OTA::UpdateObject obj;
+        String url = String(g_otaTrigger.url);
+
+        if (g_otaTrigger.force && url.length() == 0) {
+             LOG_I("[OTA] Force Update with Empty URL. Checking Defaults...");
+             obj = OTA::isUpdateAvailable();
+             if (obj.condition != OTA::NO_UPDATE) {
+                 LOG_I("[OTA] Default Update Found. Forcing Install.");
+                 obj.condition = OTA::NEW_DIFFERENT;
+             } else {
+                 LOG_I("[OTA] No Default Update Found to Force.");
+             }
+        } else {
+            obj.condition = OTA::NEW_DIFFERENT;
+            obj.tag_name = String(g_otaTrigger.version);
             
-            WiFiClientSecure client;
-            client.setCACert(OTAGH_CA_CERT);
-            OTA::init(client);
-
-            OTA::UpdateObject obj;
-            String url = String(g_otaTrigger.url);
-
-            if (g_otaTrigger.force && url.length() == 0) {
-                 Serial.println("[OTA] Force Update with Empty URL. Checking Defaults...");
-                 obj = OTA::isUpdateAvailable();
-                 if (obj.condition != OTA::NO_UPDATE) {
-                     Serial.println("[OTA] Default Update Found. Forcing Install.");
-                     obj.condition = OTA::NEW_DIFFERENT;
-                 } else {
-                     Serial.println("[OTA] No Default Update Found to Force.");
-                 }
-            } else {
-                obj.condition = OTA::NEW_DIFFERENT;
-                obj.tag_name = String(g_otaTrigger.version);
-                
-                if (url.startsWith("http")) {
-                    int protoEnd = url.indexOf("://");
-                    int pathStart = url.indexOf("/", protoEnd + 3);
-                    if (pathStart > 0) {
-                        obj.redirect_server = url.substring(protoEnd + 3, pathStart);
-                        obj.firmware_asset_endpoint = url.substring(pathStart);
-                    } else {
-                        obj.firmware_asset_endpoint = url;
-                    }
+            if (url.startsWith("http")) {
+                int protoEnd = url.indexOf("://");
+                int pathStart = url.indexOf("/", protoEnd + 3);
+                if (pathStart > 0) {
+                    obj.redirect_server = url.substring(protoEnd + 3, pathStart);
+                    obj.firmware_asset_endpoint = url.substring(pathStart);
                 } else {
                     obj.firmware_asset_endpoint = url;
                 }
+            } else {
+                obj.firmware_asset_endpoint = url;
             }
+        }
 
-            if (OTA::performUpdate(&obj, true, true, nullptr) == OTA::SUCCESS) {
-                Serial.println("[OTA] Success! Restarting...");
-                delay(1000);
-                ESP.restart();
-            }
+        if (OTA::performUpdate(&obj, true, true, nullptr) == OTA::SUCCESS) {
+            LOG_I("[OTA] Success! Restarting...");
+            delay(1000);
+            ESP.restart();
         }
-        Serial.println("\n[OTA] Failed or Canceled.");
-        ESP.restart();
     }
-    
-    delay(10);
+    LOG_E("[OTA] Failed or Canceled.");
+    ESP.restart();
 }
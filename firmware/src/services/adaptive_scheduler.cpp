@@ -0,0 +1,73 @@
+#include "adaptive_scheduler.h"
+
+AdaptiveScheduler adaptiveScheduler;
+
+RTC_DATA_ATTR static uint32_t s_times[ADAPTIVE_HISTORY_LEN];
+RTC_DATA_ATTR static float s_temps[ADAPTIVE_HISTORY_LEN];
+RTC_DATA_ATTR static uint8_t s_head = 0;
+RTC_DATA_ATTR static uint8_t s_count = 0;
+RTC_DATA_ATTR static uint32_t s_intervalMs = 0;
+
+void AdaptiveScheduler::configure(uint32_t minMs, uint32_t maxMs, uint8_t aggressiveness) {
+    _minMs = minMs;
+    _maxMs = maxMs;
+    _aggressiveness = aggressiveness;
+}
+
+bool AdaptiveScheduler::isEnabled() const {
+    return _minMs > 0 && _maxMs > _minMs && _aggressiveness > 0;
+}
+
+void AdaptiveScheduler::addSample(float temp, uint32_t now) {
+    if (isnan(temp)) {
+        return;
+    }
+    s_times[s_head] = now;
+    s_temps[s_head] = temp;
+    s_head = (s_head + 1) % ADAPTIVE_HISTORY_LEN;
+    if (s_count < ADAPTIVE_HISTORY_LEN) {
+        s_count++;
+    }
+}
+
+float AdaptiveScheduler::getSlope() const {
+    if (s_count < 2) {
+        return 0.0f;
+    }
+    // Least squares, times relative to the oldest sample to keep floats small
+    uint8_t tail = (s_head + ADAPTIVE_HISTORY_LEN - s_count) % ADAPTIVE_HISTORY_LEN;
+    uint32_t t0 = s_times[tail];
+    float sumX = 0, sumY = 0, sumXY = 0, sumXX = 0;
+    for (uint8_t i = 0; i < s_count; i++) {
+        uint8_t idx = (tail + i) % ADAPTIVE_HISTORY_LEN;
+        float x = (s_times[idx] - t0) / 60.0f; // minutes
+        float y = s_temps[idx];
+        sumX += x;
+        sumY += y;
+        sumXY += x * y;
+        sumXX += x * x;
+    }
+    float denom = s_count * sumXX - sumX * sumX;
+    if (denom < 1e-6f) {
+        return 0.0f;
+    }
+    return (s_count * sumXY - sumX * sumY) / denom;
+}
+
+uint32_t AdaptiveScheduler::nextInterval(uint32_t fixedMs) {
+    if (!isEnabled()) {
+        return fixedMs;
+    }
+
+    // e.g. aggressiveness 10 at 0.5 C/min -> max / 6
+    float target = _maxMs / (1.0f + _aggressiveness * fabsf(getSlope()));
+    uint32_t targetMs = constrain((uint32_t)target, _minMs, _maxMs);
+
+    // React immediately to faster change, but back off at most 2x per cycle
+    uint32_t current = s_intervalMs ? s_intervalMs : _maxMs;
+    if (targetMs > current && targetMs > current * 2) {
+        targetMs = current * 2;
+    }
+    s_intervalMs = constrain(targetMs, _minMs, _maxMs);
+    return s_intervalMs;
+}
@@ -0,0 +1,34 @@
+#ifndef ADAPTIVE_SCHEDULER_H
+#define ADAPTIVE_SCHEDULER_H
+
+#include <Arduino.h>
+
+#define ADAPTIVE_HISTORY_LEN 6
+
+// Picks the next sleep interval from the recent rate of temperature change:
+// fast changes pull the interval down toward min, flat readings back it off toward max.
+// History and the current interval live in RTC memory.
+class AdaptiveScheduler {
+public:
+    // Interval = max / (1 + aggressiveness * |C per minute|), clamped to [min, max].
+    // aggressiveness 0 or min >= max disables it (fixed sleep interval).
+    void configure(uint32_t minMs, uint32_t maxMs, uint8_t aggressiveness);
+    bool isEnabled() const;
+    uint32_t getMin() const { return _minMs; }
+    uint32_t getMax() const { return _maxMs; }
+    uint8_t getAggressiveness() const { return _aggressiveness; }
+
+    void addSample(float temp, uint32_t now);
+    float getSlope() const; // C per minute, least squares over the history
+    // Interval for the next sleep; returns fixedMs unchanged when disabled
+    uint32_t nextInterval(uint32_t fixedMs);
+
+private:
+    uint32_t _minMs = 0;
+    uint32_t _maxMs = 0;
+    uint8_t _aggressiveness = 0;
+};
+
+extern AdaptiveScheduler adaptiveScheduler;
+
+#endif // ADAPTIVE_SCHEDULER_H
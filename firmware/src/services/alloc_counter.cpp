@@ -0,0 +1,45 @@
+#include "alloc_counter.h"
+#include <atomic>
+
+AllocCounter allocCounter;
+
+#if WAKE_ALLOC_COUNT
+static std::atomic<uint32_t> s_allocs(0);
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    s_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    s_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    s_allocs.fetch_add(1, std::memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+}
+
+bool AllocCounter::isEnabled() const {
+    return true;
+}
+
+uint32_t AllocCounter::count() const {
+    return s_allocs.load(std::memory_order_relaxed);
+}
+#else
+bool AllocCounter::isEnabled() const {
+    return false;
+}
+
+uint32_t AllocCounter::count() const {
+    return 0;
+}
+#endif
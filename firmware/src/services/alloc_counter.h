@@ -0,0 +1,18 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <Arduino.h>
+
+// Counts heap allocation calls (malloc, calloc, realloc, and operator new through them).
+// Only active when WAKE_ALLOC_COUNT is set: firmware/version.py sets it for non-release
+// builds together with the matching -Wl,--wrap link flags. Drivers that call
+// heap_caps_malloc() directly (WiFi, BLE controller) are not seen.
+class AllocCounter {
+public:
+    bool isEnabled() const;
+    uint32_t count() const; // Calls since boot (or wake: RAM is lost in deep sleep)
+};
+
+extern AllocCounter allocCounter;
+
+#endif // ALLOC_COUNTER_H
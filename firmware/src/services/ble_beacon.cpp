@@ -0,0 +1,104 @@
+#include "ble_beacon.h"
+#include "logger.h"
+#include <NimBLEDevice.h>
+#include <mbedtls/aes.h>
+
+void hexToBytes(const char* hex, uint8_t* bytes, int len); // espnow_service.cpp
+
+BleBeacon bleBeacon;
+
+RTC_DATA_ATTR static bool s_nonceValid = false;
+RTC_DATA_ATTR static uint32_t s_nonce = 0;
+RTC_DATA_ATTR static uint32_t s_reserved = 0; // Nonces below this are covered by NVS
+
+void BleBeacon::restoreNonce(uint32_t reserved) {
+    s_nonce = reserved;
+    s_reserved = reserved;
+    s_nonceValid = true;
+}
+
+bool BleBeacon::isNonceRestored() const {
+    return s_nonceValid;
+}
+
+bool BleBeacon::needsNonceReserve() const {
+    return s_nonce == s_reserved;
+}
+
+uint32_t BleBeacon::getNonceReserve() const {
+    return s_nonce + BEACON_NONCE_RESERVE;
+}
+
+void BleBeacon::confirmNonceReserve() {
+    s_reserved = getNonceReserve();
+}
+
+bool BleBeacon::isNonceExhausted() const {
+    return needsNonceReserve() && s_nonce > UINT32_MAX - BEACON_NONCE_RESERVE;
+}
+
+// Per-epoch beacon key: one AES block of the pairing key over the label and epoch
+static void deriveEpochKey(const uint8_t* pairingKey, uint16_t epoch, uint8_t* out) {
+    uint8_t block[16] = {};
+    memcpy(block, AE_BEACON_KEY_LABEL, sizeof(AE_BEACON_KEY_LABEL) - 1);
+    block[4] = epoch & 0xFF;
+    block[5] = epoch >> 8;
+    mbedtls_aes_context aes;
+    mbedtls_aes_init(&aes);
+    mbedtls_aes_setkey_enc(&aes, pairingKey, 128);
+    mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_ENCRYPT, block, out);
+    mbedtls_aes_free(&aes);
+}
+
+void BleBeacon::sendBurst(const ae_beacon_temp_record& record, const char* keyHex) {
+    if (!isEnabled() || !s_nonceValid || needsNonceReserve()) {
+        return; // Never send a nonce that a power cycle could hand out again
+    }
+    uint32_t nonce = s_nonce++;
+    uint16_t epoch = nonce >> 16;
+
+    uint8_t pairingKey[16], key[16];
+    hexToBytes(keyHex, pairingKey, sizeof(pairingKey));
+    deriveEpochKey(pairingKey, epoch, key);
+
+    victronManufacturerData beacon;
+    memset(&beacon, 0, sizeof(beacon));
+    beacon.vendorID = AE_BEACON_VENDOR_ID;
+    beacon.beaconType = AE_BEACON_TYPE;
+    beacon.unknownData1[0] = AE_BEACON_PRODUCT_TEMP & 0xFF;
+    beacon.unknownData1[1] = AE_BEACON_PRODUCT_TEMP >> 8;
+    beacon.unknownData1[2] = AE_BEACON_RECORD_TEMP;
+    beacon.victronRecordType = AE_BEACON_RECORD_TEMP;
+    beacon.nonceDataCounter = nonce & 0xFFFF;
+    beacon.encryptKeyMatch = key[0];
+    memcpy(beacon.victronEncryptedData, &epoch, sizeof(epoch));
+
+    uint8_t counter[16] = { (uint8_t)(nonce & 0xFF), (uint8_t)((nonce >> 8) & 0xFF) };
+    uint8_t stream[16];
+    size_t streamOffset = 0;
+    mbedtls_aes_context aes;
+    mbedtls_aes_init(&aes);
+    mbedtls_aes_setkey_enc(&aes, key, 128);
+    mbedtls_aes_crypt_ctr(&aes, sizeof(record), &streamOffset, counter, stream,
+                          (const uint8_t*)&record, beacon.victronEncryptedData + sizeof(epoch));
+    mbedtls_aes_free(&aes);
+
+    // Flags + manufacturer data stay well inside the 31-byte legacy advertisement
+    size_t len = offsetof(victronManufacturerData, victronEncryptedData) + sizeof(epoch) + sizeof(record);
+    NimBLEAdvertisementData advData;
+    advData.setFlags(BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP);
+    advData.setManufacturerData(std::string((const char*)&beacon, len));
+
+    NimBLEDevice::init("");
+    NimBLEAdvertising* pAdvertising = NimBLEDevice::getAdvertising();
+    pAdvertising->setAdvertisementType(BLE_GAP_CONN_MODE_NON);
+    pAdvertising->setAdvertisementData(advData);
+    pAdvertising->setScanResponse(false);
+    pAdvertising->setMinInterval(BEACON_ADV_INTERVAL);
+    pAdvertising->setMaxInterval(BEACON_ADV_INTERVAL);
+    pAdvertising->start();
+    delay(_burstMs);
+    pAdvertising->stop();
+    NimBLEDevice::deinit(true);
+    LOG_I("[BLE] Beacon burst %u ms, epoch %u nonce %u", _burstMs, epoch, nonce & 0xFFFF);
+}
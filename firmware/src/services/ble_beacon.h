@@ -0,0 +1,42 @@
+#ifndef BLE_BEACON_H
+#define BLE_BEACON_H
+
+#include <Arduino.h>
+#include "shared_defs.h"
+
+// Connectionless telemetry: a short burst of non-connectable advertisements carrying an
+// encrypted ae_beacon_temp_record, so phones and gateways read the sensor by passive
+// scanning. The record is encrypted with a key derived from the pairing key and the epoch
+// (see shared_defs.h). The 32-bit nonce (epoch << 16 | on-air counter) advances once per
+// burst and is kept in RTC memory; main reserves blocks of it in NVS so a power cycle never
+// reuses a keystream. Once the nonce space is used up the beacon stays off until re-pairing.
+#define BEACON_ADV_INTERVAL 32      // 0.625 ms units = 20 ms, the minimum for non-connectable
+#define BEACON_NONCE_RESERVE 256    // Bursts per NVS write
+
+class BleBeacon {
+public:
+    void configure(uint16_t burstMs) { _burstMs = burstMs; }
+    uint16_t getBurstMs() const { return _burstMs; }
+    bool isEnabled() const { return _burstMs != 0; }
+
+    // After power-on: continue from the block last reserved in NVS
+    void restoreNonce(uint32_t reserved);
+    bool isNonceRestored() const;
+    // True when main must persist getNonceReserve() and confirm it before the next burst
+    bool needsNonceReserve() const;
+    uint32_t getNonceReserve() const;
+    void confirmNonceReserve();
+    // The next reserve would wrap: no further bursts under this pairing key
+    bool isNonceExhausted() const;
+
+    // Encrypts the record, advertises for the burst time and shuts NimBLE down again.
+    // Only for wakes that do not run the GATT server.
+    void sendBurst(const ae_beacon_temp_record& record, const char* keyHex);
+
+private:
+    uint16_t _burstMs = 0; // 0 = off
+};
+
+extern BleBeacon bleBeacon;
+
+#endif // BLE_BEACON_H
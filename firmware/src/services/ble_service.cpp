@@ -1,6 +1,14 @@
 #include "ble_service.h"
+#include "logger.h"
 #include <Arduino.h>
 #include <WiFi.h>
+#include "sample_buffer.h"
+#include "history_log.h"
+#include "temp_stats.h"
+#include "link_control.h"
+#include "link_stats.h"
+
+#define BLE_LOG_READ_MAX 512 // ATT attribute limit
 
 // UUIDs
 #define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b" // Reuse Smart Shunt Service for now or defined new
@@ -20,6 +28,16 @@
 #define CHAR_BATT_UUID       "beb5483e-36e1-4688-b7f5-ea07361b26ac"
 #define CHAR_NAME_UUID       "beb5483e-36e1-4688-b7f5-ea07361b26ad"
 #define CHAR_PAIRED_UUID     "beb5483e-36e1-4688-b7f5-ea07361b26ae"
+#define CHAR_ALARM_UUID      "beb5483e-36e1-4688-b7f5-ea07361b26af"
+#define CHAR_BATCH_UUID      "beb5483e-36e1-4688-b7f5-ea07361b26b0"
+#define CHAR_REPORT_UUID     "beb5483e-36e1-4688-b7f5-ea07361b26b1"
+#define CHAR_ADAPTIVE_UUID   "beb5483e-36e1-4688-b7f5-ea07361b26b2"
+#define CHAR_HISTORY_UUID    "beb5483e-36e1-4688-b7f5-ea07361b26b3"
+#define CHAR_STATS_UUID      "beb5483e-36e1-4688-b7f5-ea07361b26b4"
+#define CHAR_LINK_UUID       "beb5483e-36e1-4688-b7f5-ea07361b26b5"
+#define CHAR_DIAG_UUID       "beb5483e-36e1-4688-b7f5-ea07361b26b6"
+#define CHAR_BEACON_UUID     "beb5483e-36e1-4688-b7f5-ea07361b26b7"
+#define CHAR_LOG_UUID        "beb5483e-36e1-4688-b7f5-ea07361b26b8"
 #define WIFI_SSID_CHAR_UUID  "5A1B2C3D-4E5F-6A7B-8C9D-0E1F2A3B4C62"
 #define WIFI_PASS_CHAR_UUID  "6A1B2C3D-4E5F-6A7B-8C9D-0E1F2A3B4C63"
 
@@ -27,10 +45,16 @@ BleService bleService;
 
 class ServerCallbacks: public NimBLEServerCallbacks {
     void onConnect(NimBLEServer* pServer) {
-        Serial.println("Client connected");
+        LOG_I("Client connected");
+        bleService._peerMtu = BLE_ATT_MTU_DFLT; // Until the client negotiates
+        bleService.signalActivity();
     };
     void onDisconnect(NimBLEServer* pServer) {
-        Serial.println("Client disconnected");
+        LOG_I("Client disconnected");
+        bleService.signalActivity();
+    }
+    void onMTUChange(uint16_t MTU, ble_gap_conn_desc* desc) {
+        bleService._peerMtu = MTU;
     }
 };
 
@@ -39,7 +63,7 @@ class PairedCallback: public NimBLECharacteristicCallbacks {
         std::string value = pCharacteristic->getValue();
         if (value.length() > 0) {
             String valStr = String(value.c_str());
-            Serial.printf("[BLE WRITE] Paired/Reset Command: %s\n", valStr.c_str());
+            LOG_I("[BLE WRITE] Paired/Reset Command: %s", valStr.c_str());
             
             if (valStr.startsWith("{")) {
                 // JSON Payload -> Pairing Data
@@ -47,13 +71,13 @@ class PairedCallback: public NimBLECharacteristicCallbacks {
                      bleService._pairingDataCallback(valStr.c_str());
                 }
             } else if (valStr == "FORCE_OTA") {
-                 Serial.println("[BLE] FORCE_OTA command received.");
+                 LOG_I("[BLE] FORCE_OTA command received.");
                  if (bleService._forceOtaCallback) {
                       bleService._forceOtaCallback();
                  }
             } else if (valStr == "RESET" || valStr == "UNPAIR") {
                 // Reset Command
-                 Serial.println("Received RESET command");
+                 LOG_I("Received RESET command");
                  bleService.updatePaired(false);
             } 
         }
@@ -65,7 +89,7 @@ class WifiSsidCallback: public NimBLECharacteristicCallbacks {
         std::string value = pCharacteristic->getValue();
         if (value.length() > 0) {
              bleService._tempSsid = String(value.c_str());
-             Serial.printf("[BLE WRITE] WiFi SSID: %s\n", bleService._tempSsid.c_str());
+             LOG_I("[BLE WRITE] WiFi SSID: %s", bleService._tempSsid.c_str());
              // Pass partial or full data. If Pass is already set, this might be a refresh.
              if (bleService._wifiCallback) {
                   bleService._wifiCallback(bleService._tempSsid.c_str(), bleService._tempPass.c_str());
@@ -79,7 +103,7 @@ class WifiPassCallback: public NimBLECharacteristicCallbacks {
         std::string value = pCharacteristic->getValue();
         if (value.length() > 0) {
              bleService._tempPass = String(value.c_str());
-             Serial.println("[BLE WRITE] WiFi Pass received");
+             LOG_I("[BLE WRITE] WiFi Pass received");
              if (bleService._wifiCallback) {
                   bleService._wifiCallback(bleService._tempSsid.c_str(), bleService._tempPass.c_str());
              }
@@ -93,16 +117,201 @@ class SleepCallback: public NimBLECharacteristicCallbacks {
         if (value.length() == 4) {
              uint32_t interval = *(uint32_t*)value.data();
              bleService.setSleepInterval(interval);
-             Serial.printf("[BLE WRITE] Sleep Interval: %d ms\n", interval);
+             LOG_I("[BLE WRITE] Sleep Interval: %d ms", interval);
+             bleService.signalActivity(); // loop() persists it
         }
     }
 };
 
+class AlarmCallback: public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        if (value.length() == 8) {
+             // {float T_LOW, float T_HIGH}, NaN disables
+             float thresholds[2];
+             memcpy(thresholds, value.data(), sizeof(thresholds));
+             bleService.setAlarmThresholds(thresholds[0], thresholds[1]);
+             LOG_I("[BLE WRITE] Alarm Thresholds: low=%.2f high=%.2f", thresholds[0], thresholds[1]);
+             if (bleService._alarmCallback) {
+                  bleService._alarmCallback(thresholds[0], thresholds[1]);
+             }
+        }
+    }
+};
+
+class BatchCallback: public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        if (value.length() == 1) {
+             bleService.setBatchSize((uint8_t)value[0]);
+             LOG_I("[BLE WRITE] Batch Size: %u", bleService.getBatchSize());
+             if (bleService._batchSizeCallback) {
+                  bleService._batchSizeCallback(bleService.getBatchSize());
+             }
+        }
+    }
+};
+
+class ReportCallback: public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        if (value.length() == 8) {
+             // {float deadband C, uint32 heartbeat s}
+             float deadband;
+             uint32_t heartbeat;
+             memcpy(&deadband, value.data(), 4);
+             memcpy(&heartbeat, value.data() + 4, 4);
+             bleService.setReportConfig(deadband, heartbeat);
+             LOG_I("[BLE WRITE] Report: deadband=%.2f C heartbeat=%u s", deadband, heartbeat);
+             if (bleService._reportCallback) {
+                  bleService._reportCallback(deadband, heartbeat);
+             }
+        }
+    }
+};
+
+class LinkCallback: public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        if (value.length() == 2 || value.length() == 3) {
+             // {uint8 rate index or 0xFF auto, uint8 long range, [int8 TX power, 0 = adaptive]}
+             uint8_t rate = (uint8_t)value[0];
+             bool longRange = value[1] != 0;
+             int8_t txPower = value.length() == 3 ? (int8_t)value[2] : 0;
+             bleService.setLinkConfig(rate, longRange, txPower);
+             LOG_I("[BLE WRITE] Link: rate %u, LR %s, TX %d", rate, longRange ? "on" : "off", txPower);
+             if (bleService._linkCallback) {
+                  bleService._linkCallback(rate, longRange, txPower);
+             }
+        }
+    }
+
+    void onRead(NimBLECharacteristic* pCharacteristic) {
+        // Config followed by the live state: {config[3], int8 TX power, uint8 rate, uint8 ACK %}
+        uint8_t value[6];
+        memcpy(value, &bleService._linkConfig, 3);
+        value[3] = (uint8_t)linkControl.getTxPower();
+        value[4] = linkControl.getRate();
+        value[5] = linkControl.getAckPercent();
+        pCharacteristic->setValue(value, sizeof(value));
+    }
+};
+
+class DiagCallback: public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        if (value.length() == 4) {
+             uint32_t seconds;
+             memcpy(&seconds, value.data(), 4);
+             bleService.setDiagInterval(seconds);
+             LOG_I("[BLE WRITE] Diagnostics every %u s", seconds);
+             if (bleService._diagCallback) {
+                  bleService._diagCallback(seconds);
+             }
+        }
+    }
+
+    void onRead(NimBLECharacteristic* pCharacteristic) {
+        // {uint32 cadence s, temp_frame_diag_t counters since the last report}
+        uint8_t value[4 + sizeof(temp_frame_diag_t)];
+        temp_frame_diag_t diag;
+        linkStats.snapshot(diag);
+        memcpy(value, &bleService._diagIntervalSec, 4);
+        memcpy(value + 4, &diag, sizeof(diag));
+        pCharacteristic->setValue(value, sizeof(value));
+    }
+};
+
+class BeaconCallback: public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        if (value.length() == 2) {
+             // {uint16 burst ms per wake, 0 = beacon off}
+             uint16_t burstMs;
+             memcpy(&burstMs, value.data(), 2);
+             bleService.setBeaconBurst(burstMs);
+             LOG_I("[BLE WRITE] Beacon burst: %u ms", burstMs);
+             if (bleService._beaconCallback) {
+                  bleService._beaconCallback(burstMs);
+             }
+        }
+    }
+};
+
+class LogCallback: public NimBLECharacteristicCallbacks {
+    void onRead(NimBLECharacteristic* pCharacteristic) {
+        // Newest log ring text that fits one read
+        static char text[BLE_LOG_READ_MAX];
+        size_t len = logger.snapshot(text, sizeof(text));
+        pCharacteristic->setValue((uint8_t*)text, len);
+    }
+};
+
+class AdaptiveCallback: public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        if (value.length() == 9) {
+             // {uint32 min ms, uint32 max ms, uint8 aggressiveness}
+             uint32_t minMs, maxMs;
+             memcpy(&minMs, value.data(), 4);
+             memcpy(&maxMs, value.data() + 4, 4);
+             uint8_t aggressiveness = (uint8_t)value[8];
+             bleService.setAdaptiveConfig(minMs, maxMs, aggressiveness);
+             LOG_I("[BLE WRITE] Adaptive: %u-%u ms, aggressiveness %u", minMs, maxMs, aggressiveness);
+             if (bleService._adaptiveCallback) {
+                  bleService._adaptiveCallback(minMs, maxMs, aggressiveness);
+             }
+        }
+    }
+};
+
+class HistoryCallback: public NimBLECharacteristicCallbacks {
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        if (value.length() == 4) {
+             // uint32 start record index (0 = everything, last index + 1 = resume)
+             uint32_t start;
+             memcpy(&start, value.data(), 4);
+             bleService._historyCursor = start;
+             bleService._historyStreaming = true;
+             bleService._historyStalledSince = 0;
+             LOG_I("[BLE WRITE] History Download from %u (log %u..%u)",
+                           start, historyLog.firstIndex(), historyLog.nextIndex());
+             bleService.signalActivity(); // loop() streams it
+        }
+    }
+
+    // Called from inside notify(). Not called at all when NimBLE could not allocate the mbuf.
+    void onStatus(NimBLECharacteristic* pCharacteristic, Status s, int code) {
+        bleService._historyNotifyOk = (s == Status::SUCCESS_NOTIFY);
+    }
+};
+
+class StatsCallback: public NimBLECharacteristicCallbacks {
+    void onRead(NimBLECharacteristic* pCharacteristic) {
+        // Current hour, current day, last hour, last day
+        temp_frame_aggregate_t stats[TempStats::WINDOW_COUNT];
+        for (int i = 0; i < TempStats::WINDOW_COUNT; i++) {
+            tempStats.get((TempStats::Window)i, stats[i]);
+        }
+        pCharacteristic->setValue((uint8_t*)stats, sizeof(stats));
+    }
+};
+
 class NameCallback: public NimBLECharacteristicCallbacks {
     void onWrite(NimBLECharacteristic* pCharacteristic) {
         std::string value = pCharacteristic->getValue();
+        if (value.length() > NAME_SUFFIX_MAX_LEN) {
+             // Clamp so NVS never holds more than loadDeviceName() reads back, without
+             // splitting a UTF-8 sequence
+             size_t len = NAME_SUFFIX_MAX_LEN;
+             while (len > 0 && ((uint8_t)value[len] & 0xC0) == 0x80) {
+                 len--;
+             }
+             value.resize(len);
+        }
         if (value.length() > 0) {
-             Serial.printf("[BLE WRITE] Device Name: %s\n", value.c_str());
+             LOG_I("[BLE WRITE] Device Name: %s", value.c_str());
              bleService.updateName(value.c_str()); // Helper to notify listener
         }
     }
@@ -116,7 +325,7 @@ uint32_t generatePinFromMac() {
     // Use last 3 bytes to generate a unique 6-digit PIN
     uint32_t val = (mac[3] << 16) | (mac[4] << 8) | mac[5];
     uint32_t pin = val % 1000000;
-    Serial.printf("[BLE SEC] PIN Code: %06d\n", pin);
+    LOG_I("[BLE SEC] PIN Code: %06d", pin);
     return pin;
 }
 
@@ -147,6 +356,61 @@ void BleService::begin(const char* deviceName) {
     _pSleepChar->setCallbacks(new SleepCallback());
     _pSleepChar->setValue((uint8_t*)&_sleepIntervalMs, 4);
     
+    _pAlarmChar = _pService->createCharacteristic(
+        CHAR_ALARM_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ_ENC | NIMBLE_PROPERTY::WRITE_ENC
+    );
+    _pAlarmChar->setCallbacks(new AlarmCallback());
+    _pAlarmChar->setValue((uint8_t*)_alarmThresholds, sizeof(_alarmThresholds));
+
+    _pBatchChar = _pService->createCharacteristic(
+        CHAR_BATCH_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ_ENC | NIMBLE_PROPERTY::WRITE_ENC
+    );
+    _pBatchChar->setCallbacks(new BatchCallback());
+    _pBatchChar->setValue(&_batchSize, 1);
+
+    _pReportChar = _pService->createCharacteristic(
+        CHAR_REPORT_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ_ENC | NIMBLE_PROPERTY::WRITE_ENC
+    );
+    _pReportChar->setCallbacks(new ReportCallback());
+    _pReportChar->setValue((uint8_t*)&_reportConfig, sizeof(_reportConfig));
+
+    _pAdaptiveChar = _pService->createCharacteristic(
+        CHAR_ADAPTIVE_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ_ENC | NIMBLE_PROPERTY::WRITE_ENC
+    );
+    _pAdaptiveChar->setCallbacks(new AdaptiveCallback());
+    _pAdaptiveChar->setValue((uint8_t*)&_adaptiveConfig, sizeof(_adaptiveConfig));
+
+    _pLinkChar = _pService->createCharacteristic(
+        CHAR_LINK_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ_ENC | NIMBLE_PROPERTY::WRITE_ENC
+    );
+    _pLinkChar->setCallbacks(new LinkCallback());
+    _pLinkChar->setValue((uint8_t*)&_linkConfig, sizeof(_linkConfig));
+
+    _pDiagChar = _pService->createCharacteristic(
+        CHAR_DIAG_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ_ENC | NIMBLE_PROPERTY::WRITE_ENC
+    );
+    _pDiagChar->setCallbacks(new DiagCallback());
+
+    _pBeaconChar = _pService->createCharacteristic(
+        CHAR_BEACON_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::READ_ENC | NIMBLE_PROPERTY::WRITE_ENC
+    );
+    _pBeaconChar->setCallbacks(new BeaconCallback());
+    _pBeaconChar->setValue((uint8_t*)&_beaconBurstMs, sizeof(_beaconBurstMs));
+
+    // LOG (read-only): tail of the RAM log ring, filled on each read
+    _pLogChar = _pService->createCharacteristic(
+        CHAR_LOG_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::READ_ENC
+    );
+    _pLogChar->setCallbacks(new LogCallback());
+
     _pBattChar = _pService->createCharacteristic(
         CHAR_BATT_UUID,
         NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::READ_ENC
@@ -183,6 +447,20 @@ void BleService::begin(const char* deviceName) {
     );
     _pWifiPassChar->setCallbacks(new WifiPassCallback());
 
+    // HISTORY bulk download: write start index, records arrive as notifications
+    _pHistoryChar = _pService->createCharacteristic(
+        CHAR_HISTORY_UUID,
+        NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::WRITE_ENC
+    );
+    _pHistoryChar->setCallbacks(new HistoryCallback());
+
+    // STATS (read-only): hourly/daily rollups, filled on each read
+    _pStatsChar = _pService->createCharacteristic(
+        CHAR_STATS_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::READ_ENC
+    );
+    _pStatsChar->setCallbacks(new StatsCallback());
+
     // Start Service
     _pService->start();
 
@@ -197,7 +475,7 @@ void BleService::begin(const char* deviceName) {
     pAdvertising->setScanResponse(true);
     pAdvertising->start();
     
-    Serial.println("BLE Started (Secure)");
+    LOG_I("BLE Started (Secure)");
 }
 
 void BleService::updateTemperature(float temp) {
@@ -215,16 +493,20 @@ void BleService::updateBatteryLevel(int level) {
 }
 
 void BleService::updateName(const char* name) {
+    setName(name);
+    if (_nameCallback) {
+        _nameCallback(name);
+    }
+}
+
+void BleService::setName(const char* name) {
     if (_pNameChar) {
         // Explicitly construct string to ensure deep copy and length calculation
         std::string n(name);
-        Serial.printf("DEBUG: BLE updating name char to: '%s' (len %d)\n", n.c_str(), n.length());
+        LOG_D("DEBUG: BLE updating name char to: '%s' (len %d)", n.c_str(), n.length());
         _pNameChar->setValue(n);
         _pNameChar->notify();
     }
-    if (_nameCallback) {
-        _nameCallback(name);
-    }
 }
 
 void BleService::updatePaired(bool paired) {
@@ -259,12 +541,110 @@ void BleService::setForceOtaCallback(std::function<void()> cb) {
     _forceOtaCallback = cb;
 }
 
+void BleService::setAlarmThresholds(float low, float high) {
+    _alarmThresholds[0] = low;
+    _alarmThresholds[1] = high;
+    if (_pAlarmChar) {
+        _pAlarmChar->setValue((uint8_t*)_alarmThresholds, sizeof(_alarmThresholds));
+    }
+}
+
+void BleService::setAlarmCallback(std::function<void(float, float)> cb) {
+    _alarmCallback = cb;
+}
+
+void BleService::setBatchSize(uint8_t size) {
+    // 1 = legacy single frame per wake
+    _batchSize = constrain(size, 1, SAMPLE_BUFFER_CAPACITY);
+    if (_pBatchChar) {
+        _pBatchChar->setValue(&_batchSize, 1);
+    }
+}
+
+uint8_t BleService::getBatchSize() {
+    return _batchSize;
+}
+
+void BleService::setBatchSizeCallback(std::function<void(uint8_t)> cb) {
+    _batchSizeCallback = cb;
+}
+
+void BleService::setReportConfig(float deadbandC, uint32_t heartbeatSec) {
+    _reportConfig.deadbandC = deadbandC;
+    _reportConfig.heartbeatSec = heartbeatSec;
+    if (_pReportChar) {
+        _pReportChar->setValue((uint8_t*)&_reportConfig, sizeof(_reportConfig));
+    }
+}
+
+void BleService::setReportCallback(std::function<void(float, uint32_t)> cb) {
+    _reportCallback = cb;
+}
+
+void BleService::setAdaptiveConfig(uint32_t minMs, uint32_t maxMs, uint8_t aggressiveness) {
+    _adaptiveConfig.minMs = minMs;
+    _adaptiveConfig.maxMs = maxMs;
+    _adaptiveConfig.aggressiveness = aggressiveness;
+    if (_pAdaptiveChar) {
+        _pAdaptiveChar->setValue((uint8_t*)&_adaptiveConfig, sizeof(_adaptiveConfig));
+    }
+}
+
+void BleService::setLinkConfig(uint8_t rate, bool longRange, int8_t txPower) {
+    _linkConfig.rate = rate;
+    _linkConfig.longRange = longRange ? 1 : 0;
+    _linkConfig.txPower = txPower;
+    if (_pLinkChar) {
+        _pLinkChar->setValue((uint8_t*)&_linkConfig, sizeof(_linkConfig));
+    }
+}
+
+void BleService::setLinkCallback(std::function<void(uint8_t, bool, int8_t)> cb) {
+    _linkCallback = cb;
+}
+
+void BleService::setDiagInterval(uint32_t seconds) {
+    _diagIntervalSec = seconds;
+}
+
+void BleService::setDiagCallback(std::function<void(uint32_t)> cb) {
+    _diagCallback = cb;
+}
+
+void BleService::setBeaconBurst(uint16_t burstMs) {
+    _beaconBurstMs = burstMs;
+    if (_pBeaconChar) {
+        _pBeaconChar->setValue((uint8_t*)&_beaconBurstMs, sizeof(_beaconBurstMs));
+    }
+}
+
+void BleService::setBeaconCallback(std::function<void(uint16_t)> cb) {
+    _beaconCallback = cb;
+}
+
+void BleService::setActivityCallback(std::function<void()> cb) {
+    _activityCallback = cb;
+}
+
+void BleService::signalActivity() {
+    if (_activityCallback) {
+        _activityCallback();
+    }
+}
+
+void BleService::setAdaptiveCallback(std::function<void(uint32_t, uint32_t, uint8_t)> cb) {
+    _adaptiveCallback = cb;
+}
+
 uint32_t BleService::getSleepInterval() {
     return _sleepIntervalMs;
 }
 
 void BleService::setSleepInterval(uint32_t interval) {
     _sleepIntervalMs = interval;
+    if (_pSleepChar) {
+        _pSleepChar->setValue((uint8_t*)&_sleepIntervalMs, 4);
+    }
 }
 
 bool BleService::isConnected() {
@@ -279,10 +659,58 @@ void BleService::setPaired(bool paired) {
     _isPaired = paired;
 }
 
+// Each notification is {uint32 index of first record, history_record_t records[]},
+// filling the negotiated MTU. A notification with no records marks the end of the log.
+// The cursor only moves once NimBLE has queued a chunk: when its buffers are full
+// (BLE_HS_ENOMEM) the same chunk is retried on a later pass.
+void BleService::serviceHistoryStream() {
+    if (!_historyStreaming || !_pHistoryChar) {
+        return;
+    }
+    if (!isConnected()) {
+        _historyStreaming = false;
+        return;
+    }
+
+    static uint8_t chunk[512];
+    size_t payload = _peerMtu - 3;
+    if (payload > sizeof(chunk)) payload = sizeof(chunk);
+    size_t perChunk = (payload - 4) / sizeof(history_record_t);
+
+    for (int i = 0; i < HISTORY_NOTIFY_BURST; i++) {
+        if (_historyCursor < historyLog.firstIndex()) {
+            _historyCursor = historyLog.firstIndex();
+        }
+        memcpy(chunk, &_historyCursor, 4);
+        size_t n = historyLog.read(_historyCursor, (history_record_t*)(chunk + 4), perChunk);
+        _pHistoryChar->setValue(chunk, 4 + n * sizeof(history_record_t));
+        _historyNotifyOk = false;
+        _pHistoryChar->notify();
+
+        if (!_historyNotifyOk) {
+            // Out of buffers, or the client unsubscribed: give up once it stops draining
+            if (_historyStalledSince == 0) {
+                _historyStalledSince = millis() | 1;
+            } else if (millis() - _historyStalledSince > HISTORY_STALL_TIMEOUT_MS) {
+                LOG_W("[BLE] History Download aborted at %u", _historyCursor);
+                _historyStreaming = false;
+            }
+            return;
+        }
+        _historyStalledSince = 0;
+        if (n == 0) {
+            LOG_I("[BLE] History Download complete at %u", _historyCursor);
+            _historyStreaming = false;
+            return;
+        }
+        _historyCursor += n;
+    }
+}
+
 void BleService::startAdvertising() {
     NimBLEAdvertising* pAdvertising = NimBLEDevice::getAdvertising();
     if (pAdvertising) {
         pAdvertising->start();
-        Serial.println("[BLE] Advertising Restarted");
+        LOG_I("[BLE] Advertising Restarted");
     }
 }
@@ -3,18 +3,32 @@
 
 #include <NimBLEDevice.h>
 
+#define HISTORY_NOTIFY_BURST 4 // History notifications per serviceHistoryStream() pass
+#define HISTORY_STALL_TIMEOUT_MS 10000 // No chunk accepted for this long abandons a download
+#define NAME_SUFFIX_MAX_LEN 39 // Longest name suffix stored; BLE writes beyond it are clamped
+
 class BleService {
+    friend class ServerCallbacks;
     friend class PairedCallback;
     friend class WifiSsidCallback;
     friend class WifiPassCallback;
     friend class SleepCallback;
     friend class NameCallback;
+    friend class AlarmCallback;
+    friend class BatchCallback;
+    friend class ReportCallback;
+    friend class AdaptiveCallback;
+    friend class HistoryCallback;
+    friend class LinkCallback;
+    friend class DiagCallback;
+    friend class BeaconCallback;
     
 public:
     void begin(const char* deviceName);
     void updateTemperature(float temp);
     void updateBatteryLevel(int level);
     void updateName(const char* name);
+    void setName(const char* name); // Characteristic only, e.g. after a remote rename
     uint32_t getSleepInterval();
     bool isConnected();
     void setSleepInterval(uint32_t interval);
@@ -26,12 +40,33 @@ public:
     void setPairingDataCallback(std::function<void(const char*)> cb);
     void setWifiCallback(std::function<void(const char*, const char*)> cb);
     void setForceOtaCallback(std::function<void()> cb);
+    void setAlarmThresholds(float low, float high);
+    void setAlarmCallback(std::function<void(float, float)> cb);
+    void setBatchSize(uint8_t size);
+    uint8_t getBatchSize();
+    void setBatchSizeCallback(std::function<void(uint8_t)> cb);
+    void setReportConfig(float deadbandC, uint32_t heartbeatSec);
+    void setReportCallback(std::function<void(float, uint32_t)> cb);
+    void setAdaptiveConfig(uint32_t minMs, uint32_t maxMs, uint8_t aggressiveness);
+    void setAdaptiveCallback(std::function<void(uint32_t, uint32_t, uint8_t)> cb);
+    void setLinkConfig(uint8_t rate, bool longRange, int8_t txPower);
+    void setLinkCallback(std::function<void(uint8_t, bool, int8_t)> cb);
+    void setDiagInterval(uint32_t seconds);
+    void setDiagCallback(std::function<void(uint32_t)> cb);
+    void setBeaconBurst(uint16_t burstMs);
+    void setBeaconCallback(std::function<void(uint16_t)> cb);
     void startAdvertising();
+    // Pushes pending history download notifications; call from loop()
+    void serviceHistoryStream();
+    bool isHistoryStreaming() const { return _historyStreaming; }
+    // Connects, disconnects and writes that need loop() attention (runs on the NimBLE task)
+    void setActivityCallback(std::function<void()> cb);
     
     // Make callback accessible to friend class or just public helper
     std::function<void(const char*)> _pairingDataCallback;
 
 private:
+    void signalActivity();
     static void onConnect(NimBLEServer* pServer);
     static void onDisconnect(NimBLEServer* pServer);
     
@@ -44,16 +79,59 @@ private:
     NimBLECharacteristic* _pPairedChar;
     NimBLECharacteristic* _pWifiSsidChar;
     NimBLECharacteristic* _pWifiPassChar;
+    NimBLECharacteristic* _pAlarmChar;
+    NimBLECharacteristic* _pBatchChar;
+    NimBLECharacteristic* _pReportChar;
+    NimBLECharacteristic* _pAdaptiveChar;
+    NimBLECharacteristic* _pHistoryChar;
+    NimBLECharacteristic* _pStatsChar;
+    NimBLECharacteristic* _pLinkChar;
+    NimBLECharacteristic* _pDiagChar;
+    NimBLECharacteristic* _pBeaconChar;
+    NimBLECharacteristic* _pLogChar;
     
     std::function<void(const char*)> _nameCallback;
     std::function<void(bool)> _pairedCallback;
     std::function<void(const char*, const char*)> _wifiCallback;
     std::function<void()> _forceOtaCallback;
+    std::function<void(float, float)> _alarmCallback;
+    std::function<void(uint8_t)> _batchSizeCallback;
+    std::function<void(float, uint32_t)> _reportCallback;
+    std::function<void(uint32_t, uint32_t, uint8_t)> _adaptiveCallback;
+    std::function<void(uint8_t, bool, int8_t)> _linkCallback;
+    std::function<void(uint32_t)> _diagCallback;
+    std::function<void(uint16_t)> _beaconCallback;
+    std::function<void()> _activityCallback;
     
     bool _deviceConnected = false;
     uint32_t _sleepIntervalMs = 900000; // Default 15 mins
     bool _isPaired = false;
+    float _alarmThresholds[2] = {NAN, NAN}; // {T_LOW, T_HIGH}
+    uint8_t _batchSize = 1; // Samples per ESP-NOW uplink
+    struct __attribute__((packed)) {
+        float deadbandC;       // 0 = report every sample
+        uint32_t heartbeatSec; // Max silent interval, 0 = none
+    } _reportConfig = {0.0f, 0};
+    struct __attribute__((packed)) {
+        uint32_t minMs;
+        uint32_t maxMs;
+        uint8_t aggressiveness; // 0 = fixed interval
+    } _adaptiveConfig = {0, 0, 0};
+    struct __attribute__((packed)) {
+        uint8_t rate;      // PHY rate ladder index, 0xFF = auto
+        uint8_t longRange; // 802.11 LR protocol enabled
+        int8_t txPower;    // 0.25 dBm units, 0 = adaptive
+    } _linkConfig = {0xFF, 0, 0};
+    uint32_t _diagIntervalSec = 0; // Link diagnostics cadence, 0 = off
+    uint16_t _beaconBurstMs = 0; // Encrypted advertising burst per timer wake, 0 = off
     
+    // History bulk download: next record index to notify
+    bool _historyStreaming = false;
+    uint32_t _historyCursor = 0;
+    bool _historyNotifyOk = false; // Set by the notify status callback
+    uint32_t _historyStalledSince = 0; // millis() of the first refused chunk, 0 = flowing
+    volatile uint16_t _peerMtu = BLE_ATT_MTU_DFLT; // Cached from connect/MTU exchange
+
     // Temp storage for WiFi creds until both are received or processed
     String _tempSsid;
     String _tempPass;
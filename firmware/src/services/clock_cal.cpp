@@ -0,0 +1,48 @@
+#include "clock_cal.h"
+#include "logger.h"
+#include "slot_schedule.h"
+
+ClockCal clockCal;
+
+RTC_DATA_ATTR static bool s_haveRef = false;
+RTC_DATA_ATTR static uint32_t s_refGatewayMs = 0;
+RTC_DATA_ATTR static uint64_t s_refLocalMs = 0;
+RTC_DATA_ATTR static bool s_calibrated = false;
+RTC_DATA_ATTR static int32_t s_ppm = 0;
+
+void ClockCal::onTimeSync(uint32_t gatewayMs) {
+    uint64_t localMs = SlotSchedule::nowMs();
+    if (s_haveRef) {
+        uint32_t gatewaySpan = gatewayMs - s_refGatewayMs; // Wraps like millis()
+        int64_t localSpan = (int64_t)(localMs - s_refLocalMs);
+        if (gatewaySpan < CLOCK_CAL_MIN_SPAN_MS && localSpan >= 0) {
+            return; // Keep the older reference until the span gives useful precision
+        }
+        if (gatewaySpan <= CLOCK_CAL_MAX_SPAN_MS && localSpan > 0) {
+            int64_t ppm = (localSpan - (int64_t)gatewaySpan) * 1000000 / gatewaySpan;
+            if (ppm > -CLOCK_CAL_MAX_PPM && ppm < CLOCK_CAL_MAX_PPM) {
+                // Filter: the error follows temperature, but single spans carry radio jitter
+                s_ppm = s_calibrated ? s_ppm + ((int32_t)ppm - s_ppm) / 4 : (int32_t)ppm;
+                s_calibrated = true;
+                LOG_I("[CLK] Slow clock %+ld ppm (span %u ms), using %+ld ppm",
+                              (long)ppm, gatewaySpan, (long)s_ppm);
+            }
+        }
+        // Implausible spans (gateway reboot, local clock reset) simply restart the reference
+    }
+    s_refGatewayMs = gatewayMs;
+    s_refLocalMs = localMs;
+    s_haveRef = true;
+}
+
+uint32_t ClockCal::toLocalMs(uint32_t realMs) const {
+    return (uint32_t)((int64_t)realMs * (1000000 + s_ppm) / 1000000);
+}
+
+int32_t ClockCal::getPpm() const {
+    return s_ppm;
+}
+
+bool ClockCal::isCalibrated() const {
+    return s_calibrated;
+}
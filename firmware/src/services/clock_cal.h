@@ -0,0 +1,28 @@
+#ifndef CLOCK_CAL_H
+#define CLOCK_CAL_H
+
+#include <Arduino.h>
+
+// RTC slow-clock drift correction. The C3's RC slow clock runs the deep sleep timer and
+// device time while asleep; it is calibrated against the crystal only briefly at boot, so
+// it is off by up to several percent and drifts with temperature. The gateway sends its
+// (crystal) millis() in struct_message_time_sync; comparing the gateway and local elapsed
+// time between two syncs gives the slow-clock error, which is filtered and applied to all
+// further sleep durations.
+#define CLOCK_CAL_MIN_SPAN_MS (10UL * 60 * 1000)       // Shortest reference span (ms jitter -> ~ppm)
+#define CLOCK_CAL_MAX_SPAN_MS (3UL * 24 * 60 * 60 * 1000) // Older references are discarded
+#define CLOCK_CAL_MAX_PPM 100000                        // Reject anything beyond +-10 %
+
+class ClockCal {
+public:
+    // From the recv callback, with the gateway's millis() at send time
+    void onTimeSync(uint32_t gatewayMs);
+    // Local (slow clock) time that corresponds to realMs of gateway time
+    uint32_t toLocalMs(uint32_t realMs) const;
+    int32_t getPpm() const;     // > 0: the slow clock runs fast
+    bool isCalibrated() const;
+};
+
+extern ClockCal clockCal;
+
+#endif // CLOCK_CAL_H
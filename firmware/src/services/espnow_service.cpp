@@ -1,22 +1,128 @@
 #include "espnow_service.h"
+#include "logger.h"
+#include "link_control.h"
+#include "link_stats.h"
+#include <esp_wifi.h>
 
 EspNowService espNowService;
 
 // Broadcast address
 uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
+// Gateway channel cache, valid across deep sleep
+RTC_DATA_ATTR static uint8_t s_channel = 0;
+RTC_DATA_ATTR static uint8_t s_failCount = 0;
+static volatile uint8_t s_sweepHit = 0; // Channel of a sweep probe ACKed after the sweep moved on
+
+// In-flight frames, in submission order
+enum SlotState : uint8_t { SLOT_FREE, SLOT_PENDING, SLOT_DONE, SLOT_ABANDONED };
+typedef struct {
+    volatile uint8_t state;
+    volatile bool success;
+    uint32_t sentUs;
+    uint8_t channel; // Channel the frame went out on: its ACK can arrive after a retune
+    bool probe;      // Channel sweep probe
+    SemaphoreHandle_t done;
+    StaticSemaphore_t doneBuf;
+} SendSlot;
+
+static SendSlot s_slots[ESPNOW_MAX_PENDING];
+static uint8_t s_fifo[ESPNOW_MAX_PENDING];
+static uint8_t s_fifoHead = 0;
+static uint8_t s_fifoCount = 0;
+static portMUX_TYPE s_sendMux = portMUX_INITIALIZER_UNLOCKED;
+
+// RSSI of the last management frame (ESP-NOW is sent as action frames) from the gateway
+static uint8_t s_gatewayMac[6] = {0};
+static volatile int8_t s_lastRssi = 0;
+
+static void onPromiscuousRx(void* buf, wifi_promiscuous_pkt_type_t type) {
+    const wifi_promiscuous_pkt_t* pkt = (const wifi_promiscuous_pkt_t*)buf;
+    // 802.11 header: addr2 (transmitter) at offset 10
+    if (type == WIFI_PKT_MGMT && memcmp(pkt->payload + 10, s_gatewayMac, 6) == 0) {
+        s_lastRssi = pkt->rx_ctrl.rssi;
+    }
+}
+
+static uint8_t currentChannel() {
+    uint8_t primary = 0;
+    wifi_second_chan_t second;
+    esp_wifi_get_channel(&primary, &second);
+    return primary;
+}
+
 void EspNowService::onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-    Serial.print("Last Packet Send Status: ");
-    Serial.println(status == ESP_NOW_SEND_SUCCESS ? "Delivery Success" : "Delivery Fail");
-    espNowService.sendFinished = true;
-    espNowService.sendSuccess = (status == ESP_NOW_SEND_SUCCESS);
+    LOG_D("Last Packet Send Status: %s", status == ESP_NOW_SEND_SUCCESS ? "Delivery Success" : "Delivery Fail");
+
+    // The result belongs to the oldest in-flight frame
+    SendSlot* slot = nullptr;
+    uint32_t latencyUs = 0;
+    uint8_t channel = 0;
+    bool probe = false;
+    portENTER_CRITICAL(&s_sendMux);
+    if (s_fifoCount > 0) {
+        slot = &s_slots[s_fifo[s_fifoHead]];
+        s_fifoHead = (s_fifoHead + 1) % ESPNOW_MAX_PENDING;
+        s_fifoCount--;
+        latencyUs = micros() - slot->sentUs;
+        channel = slot->channel;
+        probe = slot->probe;
+    }
+    portEXIT_CRITICAL(&s_sendMux);
+
+    // Only unicasts are ACKed, broadcasts always "succeed"
+    if (slot && memcmp(mac_addr, broadcastAddress, 6) != 0) {
+        if (!probe) {
+            // Wrong-channel probes say nothing about the link or delivery
+            linkStats.recordSend(status == ESP_NOW_SEND_SUCCESS, latencyUs);
+            linkControl.onSendResult(status == ESP_NOW_SEND_SUCCESS);
+        }
+        if (status == ESP_NOW_SEND_SUCCESS) {
+            s_channel = channel;
+            s_failCount = 0;
+            if (probe) {
+                s_sweepHit = channel;
+            }
+        } else if (!probe && s_failCount < 0xFF) {
+            s_failCount++;
+        }
+    }
+
+    // Complete it, unless its wait() already gave up
+    portENTER_CRITICAL(&s_sendMux);
+    if (slot) {
+        if (slot->state == SLOT_ABANDONED) {
+            slot->state = SLOT_FREE;
+            slot = nullptr;
+        } else {
+            slot->success = (status == ESP_NOW_SEND_SUCCESS);
+            slot->state = SLOT_DONE;
+        }
+    }
+    portEXIT_CRITICAL(&s_sendMux);
+    if (slot) {
+        xSemaphoreGive(slot->done);
+    }
 }
 
 void EspNowService::begin() {
+    static bool slotsReady = false;
+    if (!slotsReady) {
+        for (int i = 0; i < ESPNOW_MAX_PENDING; i++) {
+            s_slots[i].done = xSemaphoreCreateBinaryStatic(&s_slots[i].doneBuf);
+        }
+        slotsReady = true;
+    }
+    for (int i = 0; i < ESPNOW_MAX_PENDING; i++) {
+        s_slots[i].state = SLOT_FREE;
+    }
+    s_fifoHead = 0;
+    s_fifoCount = 0;
+
     WiFi.mode(WIFI_STA);
     
     if (esp_now_init() != ESP_OK) {
-        Serial.println("Error initializing ESP-NOW");
+        LOG_E("Error initializing ESP-NOW");
         return;
     }
     
@@ -31,54 +137,212 @@ void EspNowService::begin() {
     peerInfo.ifidx = WIFI_IF_STA; // Explicitly set interface
     
     if (esp_now_add_peer(&peerInfo) != ESP_OK){
-        Serial.println("Failed to add peer");
+        LOG_E("Failed to add peer");
         return;
     }
+
+    linkControl.begin();
 }
 
-void EspNowService::registerRecvCallback(esp_now_recv_cb_t callback) {
-    esp_now_register_recv_cb(callback);
+EspNowHandle EspNowService::send(const uint8_t* peerMac, const uint8_t* data, size_t len, bool track) {
+    EspNowHandle handle = ESPNOW_NO_HANDLE;
+    portENTER_CRITICAL(&s_sendMux);
+    for (int i = 0; i < ESPNOW_MAX_PENDING; i++) {
+        if (s_slots[i].state == SLOT_FREE) {
+            handle = i;
+            break;
+        }
+    }
+    if (handle != ESPNOW_NO_HANDLE) {
+        // Untracked frames are abandoned from the start: the callback just frees them
+        s_slots[handle].state = track ? SLOT_PENDING : SLOT_ABANDONED;
+        s_fifo[(s_fifoHead + s_fifoCount) % ESPNOW_MAX_PENDING] = handle;
+        s_fifoCount++;
+    }
+    portEXIT_CRITICAL(&s_sendMux);
+
+    if (handle == ESPNOW_NO_HANDLE) {
+        LOG_W("ESP-NOW Send Queue Full!");
+        return ESPNOW_NO_HANDLE;
+    }
+    xSemaphoreTake(s_slots[handle].done, 0); // Clear a give that raced a timed-out wait()
+    linkControl.applyPending();
+    s_slots[handle].sentUs = micros();
+    s_slots[handle].channel = currentChannel();
+    s_slots[handle].probe = m_sweeping;
+
+    esp_err_t result = esp_now_send(peerMac, data, len);
+    if (result != ESP_OK) {
+        // No callback will come: take the frame back off the tail
+        portENTER_CRITICAL(&s_sendMux);
+        s_fifoCount--;
+        s_slots[handle].state = SLOT_FREE;
+        portEXIT_CRITICAL(&s_sendMux);
+        LOG_E("Error sending ESP-NOW: %d", result);
+        return ESPNOW_NO_HANDLE;
+    }
+    return track ? handle : ESPNOW_NO_HANDLE;
 }
 
-void EspNowService::broadcast(const TempSensorData& data) {
-    Serial.println("=== Temp Sensor ===");
-    Serial.printf("ID             : %d\n", data.id);
-    Serial.printf("Name           : %s\n", data.name);
-    Serial.printf("Temperature    : %.2f C\n", data.temperature);
-    Serial.printf("Battery Voltage: %.2f V\n", data.batteryVoltage);
-    Serial.printf("Battery Level  : %d %%\n", data.batteryLevel);
-    Serial.println("===================");
-
-    esp_err_t result = esp_now_send(broadcastAddress, (uint8_t *) &data, sizeof(data));
-
-    if (result == ESP_OK) {
-        Serial.println("Sent BROADCAST Success");
+bool EspNowService::wait(EspNowHandle handle, uint32_t timeoutMs) {
+    if (handle == ESPNOW_NO_HANDLE) {
+        return false;
+    }
+    SendSlot& slot = s_slots[handle];
+    bool signalled = xSemaphoreTake(slot.done, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+
+    bool finished, success = false;
+    portENTER_CRITICAL(&s_sendMux);
+    finished = signalled || slot.state == SLOT_DONE;
+    if (finished) {
+        success = slot.success;
+        slot.state = SLOT_FREE;
     } else {
-        Serial.println("Error sending BROADCAST");
+        slot.state = SLOT_ABANDONED; // The late callback frees it
+    }
+    portEXIT_CRITICAL(&s_sendMux);
+
+    if (!finished) {
+        LOG_W("ESP-NOW Send Timeout!");
+    } else if (!success) {
+        LOG_E("ESP-NOW Send Failed!");
     }
+    return success;
 }
 
-void EspNowService::sendToPeer(const TempSensorData& data, const uint8_t* peerMac) {
-    Serial.printf("=== Sending to Peer %02X:%02X:%02X:%02X:%02X:%02X ===\n", 
-                  peerMac[0], peerMac[1], peerMac[2], peerMac[3], peerMac[4], peerMac[5]);
-    
-    // Restore detailed data logging as requested
-    Serial.println("=== Temp Sensor ===");
-    Serial.printf("ID             : %d\n", data.id);
-    Serial.printf("Name           : %s\n", data.name);
-    Serial.printf("Temperature    : %.2f C\n", data.temperature);
-    Serial.printf("Battery Voltage: %.2f V\n", data.batteryVoltage);
-    Serial.printf("Battery Level  : %d %%\n", data.batteryLevel);
-    Serial.printf("Interval       : %d ms\n", data.updateInterval);
-    Serial.println("===================");
-
-    esp_err_t result = esp_now_send(peerMac, (uint8_t *) &data, sizeof(data));
-    
-    if (result == ESP_OK) {
-        Serial.println("Sent UNICAST Success");
-    } else {
-        Serial.printf("Error sending UNICAST: %d\n", result);
+void EspNowService::release(EspNowHandle handle) {
+    if (handle == ESPNOW_NO_HANDLE) {
+        return;
+    }
+    portENTER_CRITICAL(&s_sendMux);
+    s_slots[handle].state = (s_slots[handle].state == SLOT_DONE) ? SLOT_FREE : SLOT_ABANDONED;
+    portEXIT_CRITICAL(&s_sendMux);
+}
+
+bool EspNowService::sendAndWait(const uint8_t* peerMac, const uint8_t* data, size_t len,
+                                const EspNowSendOptions& options) {
+    uint32_t backoff = options.backoffMs;
+    for (int attempt = 0; attempt <= options.retries; attempt++) {
+        if (attempt > 0) {
+            LOG_W("ESP-NOW Retry %d in %u ms", attempt, backoff);
+            linkStats.recordRetry();
+            delay(backoff);
+            backoff *= 2;
+        }
+        if (wait(send(peerMac, data, len), options.timeoutMs)) {
+            return true;
+        }
     }
+    return false;
+}
+
+void EspNowService::tune(uint8_t channel) {
+    esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+}
+
+void EspNowService::setRssiCapture(bool enable) {
+    if (enable) {
+        wifi_promiscuous_filter_t filter = { WIFI_PROMIS_FILTER_MASK_MGMT };
+        esp_wifi_set_promiscuous_filter(&filter);
+        esp_wifi_set_promiscuous_rx_cb(onPromiscuousRx);
+    }
+    esp_wifi_set_promiscuous(enable);
+}
+
+int8_t EspNowService::getLastRssi() const {
+    return s_lastRssi;
+}
+
+uint8_t EspNowService::getChannel() const {
+    return s_channel;
+}
+
+void EspNowService::restoreChannel(uint8_t savedChannel) {
+    if (s_channel == 0 && savedChannel >= 1 && savedChannel <= ESPNOW_MAX_CHANNEL) {
+        s_channel = savedChannel;
+    }
+    if (s_channel != 0) {
+        tune(s_channel);
+    }
+}
+
+void EspNowService::noteGatewayHeard() {
+    s_channel = currentChannel();
+    s_failCount = 0;
+}
+
+bool EspNowService::needsSweep() const {
+    return s_channel == 0 || s_failCount >= CHANNEL_SWEEP_AFTER_FAILS;
+}
+
+void EspNowService::broadcastDiscovery(const TempSensorData& data, bool forceSweep) {
+    static uint8_t sinceSweep = 0;
+    if (!forceSweep && !needsSweep() && ++sinceSweep < DISCOVERY_SWEEP_EVERY) {
+        tune(s_channel);
+        broadcast(data);
+        return;
+    }
+    // Hunt on every channel, then park on the last known one
+    sinceSweep = 0;
+    for (int ch = 1; ch <= ESPNOW_MAX_CHANNEL; ch++) {
+        tune(ch);
+        delay(10);
+        broadcast(data);
+    }
+    tune(s_channel != 0 ? s_channel : 1);
+}
+
+bool EspNowService::sweepForPeer(const uint8_t* data, size_t len, const uint8_t* peerMac) {
+    LOG_W("Gateway channel unknown/stale: sweeping");
+    m_sweeping = true;
+    s_sweepHit = 0;
+    for (int ch = 1; ch <= ESPNOW_MAX_CHANNEL && s_sweepHit == 0; ch++) {
+        tune(ch);
+        if (wait(send(peerMac, data, len), 30)) {
+            LOG_I("Gateway found on channel %d", ch);
+            m_sweeping = false;
+            return true; // onDataSent cached the channel
+        }
+    }
+    m_sweeping = false;
+    if (s_sweepHit != 0) {
+        // An earlier probe was ACKed after its wait timed out: go back to its channel
+        tune(s_sweepHit);
+        LOG_I("Gateway found on channel %d (late ACK)", s_sweepHit);
+        return true;
+    }
+    // Gateway is probably down rather than moved: wait for another run of failures before
+    // the next sweep instead of burning ~400ms on every wake of an outage
+    s_failCount = 0;
+    tune(s_channel != 0 ? s_channel : 1);
+    return false;
+}
+
+void EspNowService::registerRecvCallback(esp_now_recv_cb_t callback) {
+    esp_now_register_recv_cb(callback);
+}
+
+void EspNowService::broadcast(const TempSensorData& data) {
+    LOG_D("[ESP-NOW] Broadcast: id %d '%s' %.2f C, %.2f V, %d %%", data.id, data.name,
+          data.temperature, data.batteryVoltage, data.batteryLevel);
+
+    send(broadcastAddress, (const uint8_t *) &data, sizeof(data), false);
+}
+
+EspNowHandle EspNowService::sendToPeer(const TempSensorData& data, const uint8_t* peerMac) {
+    LOG_D("[ESP-NOW] To %02X:%02X:%02X:%02X:%02X:%02X: id %d '%s' %.2f C, %.2f V, %d %%, %u ms",
+          peerMac[0], peerMac[1], peerMac[2], peerMac[3], peerMac[4], peerMac[5], data.id, data.name,
+          data.temperature, data.batteryVoltage, data.batteryLevel, data.updateInterval);
+
+    return send(peerMac, (const uint8_t *) &data, sizeof(data));
+}
+
+EspNowHandle EspNowService::sendAlarm(const TempAlarmData& alarm, const uint8_t* peerMac) {
+    LOG_W("=== ALARM %s: %.2f C (low %.2f / high %.2f) ===",
+                  alarm.active ? "TRIPPED" : "CLEARED", alarm.temperature,
+                  alarm.thresholdLow, alarm.thresholdHigh);
+
+    return send(peerMac, (const uint8_t *) &alarm, sizeof(alarm));
 }
 
 // Helper to convert hex string to byte array
@@ -117,11 +381,10 @@ void EspNowService::addSecurePeer(const char* macStr, const char* keyStr) {
     peerInfo.ifidx = WIFI_IF_STA;
     
     if (esp_now_add_peer(&peerInfo) == ESP_OK) {
-        Serial.printf("Secure Peer Added: %s\n", macStr);
-        Serial.print("Key used: ");
-        for(int i=0; i<16; i++) Serial.printf("%02X", keyBytes[i]);
-        Serial.println();
+        LOG_I("Secure Peer Added: %s", macStr);
+        memcpy(s_gatewayMac, peerMac, 6); // RSSI capture matches on it
+        LOG_D("Key used: %02X%02X%02X%02X...", keyBytes[0], keyBytes[1], keyBytes[2], keyBytes[3]);
     } else {
-        Serial.println("Failed to Add Secure Peer");
+        LOG_E("Failed to Add Secure Peer");
     }
 }
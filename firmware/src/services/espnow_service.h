@@ -4,28 +4,73 @@
 #include <Arduino.h>
 #include <esp_now.h>
 #include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include "shared_defs.h"
 
+#define ESPNOW_MAX_CHANNEL 13
+#define CHANNEL_SWEEP_AFTER_FAILS 3 // Consecutive unicast failures before re-scanning channels
+#define DISCOVERY_SWEEP_EVERY 12    // Cached-channel discovery broadcasts per full sweep
+
 typedef struct_message_temp_sensor TempSensorData;
+typedef struct_message_temp_alarm TempAlarmData;
+
+// Per-frame send tracking. ESP-NOW reports results in submission order, so in-flight
+// frames form a FIFO that onDataSent completes one by one (each slot has a semaphore).
+#define ESPNOW_MAX_PENDING 16
+#define ESPNOW_NO_HANDLE -1
+typedef int8_t EspNowHandle;
+
+typedef struct {
+    uint32_t timeoutMs; // ACK wait per attempt
+    uint8_t retries;    // Extra attempts after the first
+    uint32_t backoffMs; // Pause before the first retry, doubled for each further one
+} EspNowSendOptions;
 
 class EspNowService {
 public:
     void begin();
     void registerRecvCallback(esp_now_recv_cb_t callback);
-    void broadcast(const TempSensorData& data);
-    void sendToPeer(const TempSensorData& data, const uint8_t* peerMac);
+    void broadcast(const TempSensorData& data); // Fire and forget
+    EspNowHandle sendToPeer(const TempSensorData& data, const uint8_t* peerMac);
+    EspNowHandle sendAlarm(const TempAlarmData& alarm, const uint8_t* peerMac);
+
+    // Queues a frame; several can be in flight. Untracked frames complete on their own,
+    // tracked ones must be passed to wait() or release(). ESPNOW_NO_HANDLE if not queued.
+    EspNowHandle send(const uint8_t* peerMac, const uint8_t* data, size_t len, bool track = true);
+    // Blocks until the frame's send callback (or the timeout) and frees the handle. True on ACK.
+    bool wait(EspNowHandle handle, uint32_t timeoutMs);
+    void release(EspNowHandle handle);
+    // send() + wait() with retries and exponential backoff
+    bool sendAndWait(const uint8_t* peerMac, const uint8_t* data, size_t len, const EspNowSendOptions& options);
     void addSecurePeer(const char* macStr, const char* keyStr);
+
+    // Gateway channel cache: learned from ACKs and frames received from the gateway,
+    // kept in RTC memory (main persists it to NVS). 0 = unknown.
+    uint8_t getChannel() const;
+    void restoreChannel(uint8_t savedChannel); // After begin(): RTC cache first, else the NVS copy
+    void noteGatewayHeard();                   // Call from the recv callback for gateway frames
+    bool needsSweep() const;
+    // Discovery broadcast on the cached channel. Sweeps 1-13 while the channel is unknown,
+    // every DISCOVERY_SWEEP_EVERY calls (a new gateway may sit elsewhere) or when forced.
+    void broadcastDiscovery(const TempSensorData& data, bool forceSweep = false);
+    // Unicasts the payload on each channel until the peer ACKs. Returns true once found.
+    bool sweepForPeer(const uint8_t* data, size_t len, const uint8_t* peerMac);
+    // RSSI (dBm) of the last frame heard from the secure peer, 0 = none yet. esp_now_recv_cb_t
+    // does not report it on IDF 4.4, so it comes from promiscuous mode: every management frame
+    // on the channel then reaches a callback, so only capture around the gateway's replies.
+    void setRssiCapture(bool enable);
+    int8_t getLastRssi() const;
     
     void setForceBroadcast(bool force) { m_forceBroadcast = force; }
     bool isForceBroadcast() { return m_forceBroadcast; }
-    
-    volatile bool sendFinished = false;
-    volatile bool sendSuccess = false;
-    void resetSendStatus() { sendFinished = false; sendSuccess = false; }
+
 
 private:
     static void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status);
+    void tune(uint8_t channel);
     bool m_forceBroadcast = false;
+    volatile bool m_sweeping = false;
 };
 
 extern EspNowService espNowService;
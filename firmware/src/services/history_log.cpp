@@ -0,0 +1,331 @@
+#include "history_log.h"
+#include "logger.h"
+
+HistoryLog historyLog;
+
+#define HISTORY_SUBTYPE 0x40
+#define SECTOR_SIZE 4096
+#define SECTOR_MAGIC 0x32484541 // "AEH2"
+#define LEGACY_MAGIC 0x4C484541 // "AEHL": 8 byte header, records indexed as uplink seqs
+#define LEGACY_RECORDS_PER_SECTOR 511
+#define RECORDS_PER_SECTOR ((SECTOR_SIZE - sizeof(SectorHeader)) / sizeof(history_record_t))
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;         // Sector sequence
+    uint32_t firstSample; // Sample seq of slot 0
+} SectorHeader;
+
+// Write position, valid across deep sleep. s_valid is cleared by the loader on power-on.
+RTC_DATA_ATTR static bool s_valid = false;
+RTC_DATA_ATTR static bool s_hasHead = false;    // False until the first sector is written
+RTC_DATA_ATTR static uint32_t s_headSeq = 0;    // Sequence of the sector being written
+RTC_DATA_ATTR static uint32_t s_headSector = 0;
+RTC_DATA_ATTR static uint32_t s_headSlot = 0;   // Next free slot in the head sector
+RTC_DATA_ATTR static uint32_t s_headFirst = 0;  // Sample seq of the head sector's slot 0
+RTC_DATA_ATTR static uint32_t s_tailSeq = 0;    // Oldest sector still holding data
+RTC_DATA_ATTR static uint32_t s_legacyEnd = 0;  // Seqs below this were used by a legacy log
+
+// Sample seq counter
+RTC_DATA_ATTR static bool s_seqValid = false;
+RTC_DATA_ATTR static uint32_t s_nextSeq = 0;
+RTC_DATA_ATTR static uint32_t s_seqReserved = 0; // Seqs below this are covered by NVS
+
+static uint8_t recordCheck(const history_record_t& r) {
+    const uint8_t* p = (const uint8_t*)&r;
+    uint8_t sum = 0x5A;
+    for (size_t i = 0; i < offsetof(history_record_t, check); i++) {
+        sum = (sum << 1 | sum >> 7) ^ p[i];
+    }
+    return sum == 0xFF ? 0xFE : sum; // Never looks like erased flash
+}
+
+bool HistoryLog::isValid(const history_record_t& r) {
+    return r.check == recordCheck(r);
+}
+
+static bool isErased(const history_record_t& r) {
+    return r.check == 0xFF && r.timestamp == 0xFFFFFFFF;
+}
+
+bool HistoryLog::begin() {
+    _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)HISTORY_SUBTYPE, "histlog");
+    if (!_part) {
+        // Units updated over the air keep their original table: reuse its (otherwise unused) SPIFFS area
+        _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, nullptr);
+    }
+    if (!_part || _part->size < 2 * SECTOR_SIZE) {
+        LOG_W("[HIST] No history partition");
+        _part = nullptr;
+        return false;
+    }
+    _sectorCount = _part->size / SECTOR_SIZE;
+
+    if (s_valid && s_headSector < _sectorCount) {
+        return true;
+    }
+    return scan();
+}
+
+bool HistoryLog::scan() {
+    // Find the newest and oldest sectors by sequence number
+    bool found = false;
+    uint32_t maxSeq = 0, minSeq = 0, maxSector = 0;
+    for (uint32_t i = 0; i < _sectorCount; i++) {
+        SectorHeader hdr;
+        if (esp_partition_read(_part, sectorOffset(i), &hdr, sizeof(hdr)) != ESP_OK) {
+            continue;
+        }
+        if (hdr.magic == LEGACY_MAGIC) {
+            // Old format: keep new seqs clear of every index it could have sent
+            uint32_t end = (hdr.seq + 1) * LEGACY_RECORDS_PER_SECTOR;
+            if (end > s_legacyEnd) {
+                s_legacyEnd = end;
+            }
+            continue;
+        }
+        if (hdr.magic != SECTOR_MAGIC) {
+            continue;
+        }
+        if (!found || hdr.seq > maxSeq) {
+            maxSeq = hdr.seq;
+            maxSector = i;
+        }
+        if (!found || hdr.seq < minSeq) {
+            minSeq = hdr.seq;
+        }
+        found = true;
+    }
+
+    if (!found) {
+        // Blank (or foreign) partition: the first append starts a fresh log
+        LOG_I("[HIST] Formatting history log");
+        s_hasHead = false;
+        s_tailSeq = 0;
+        s_valid = true;
+        return true;
+    }
+
+    // Binary search for the first erased slot in the head sector
+    uint32_t lo = 0, hi = RECORDS_PER_SECTOR;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        history_record_t r;
+        esp_partition_read(_part, sectorOffset(maxSector) + sizeof(SectorHeader) + mid * sizeof(history_record_t), &r, sizeof(r));
+        if (isErased(r)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    SectorHeader head;
+    if (esp_partition_read(_part, sectorOffset(maxSector), &head, sizeof(head)) != ESP_OK) {
+        return false;
+    }
+    s_hasHead = true;
+    s_headSeq = maxSeq;
+    s_headSector = maxSector;
+    s_headSlot = lo;
+    s_headFirst = head.firstSample;
+    s_tailSeq = minSeq;
+    s_valid = true;
+    LOG_I("[HIST] Mounted: records %u..%u", firstIndex(), nextIndex());
+    return true;
+}
+
+bool HistoryLog::startSector(uint32_t sector, uint32_t seq, uint32_t firstSample) {
+    if (esp_partition_erase_range(_part, sectorOffset(sector), SECTOR_SIZE) != ESP_OK) {
+        return false;
+    }
+    SectorHeader hdr = { SECTOR_MAGIC, seq, firstSample };
+    if (esp_partition_write(_part, sectorOffset(sector), &hdr, sizeof(hdr)) != ESP_OK) {
+        return false;
+    }
+    s_hasHead = true;
+    s_headSeq = seq;
+    s_headSector = sector;
+    s_headSlot = 0;
+    s_headFirst = firstSample;
+    // The sector we just erased held the oldest data once the log has wrapped
+    if (seq >= _sectorCount && s_tailSeq <= seq - _sectorCount) {
+        s_tailSeq = seq - _sectorCount + 1;
+    }
+    return true;
+}
+
+void HistoryLog::restoreSeq(uint32_t reserved) {
+    // A factory reset or an older firmware's log can leave NVS behind the stored samples
+    uint32_t next = reserved;
+    if (s_legacyEnd > next) {
+        next = s_legacyEnd;
+    }
+    if (s_hasHead && s_headFirst + s_headSlot > next) {
+        next = s_headFirst + s_headSlot;
+    }
+    s_nextSeq = next;
+    s_seqReserved = next;
+    s_seqValid = true;
+}
+
+bool HistoryLog::isSeqRestored() const {
+    return s_seqValid;
+}
+
+bool HistoryLog::needsSeqReserve() const {
+    return s_nextSeq >= s_seqReserved;
+}
+
+uint32_t HistoryLog::getSeqReserve() const {
+    return s_nextSeq + HISTORY_SEQ_RESERVE;
+}
+
+void HistoryLog::confirmSeqReserve() {
+    s_seqReserved = getSeqReserve();
+}
+
+uint32_t HistoryLog::takeSeq() {
+    return s_nextSeq++;
+}
+
+bool HistoryLog::append(uint32_t seq, uint32_t timestamp, int16_t centiC, uint8_t flags) {
+    if (!_part) {
+        return false;
+    }
+    // Slots map to consecutive seqs, so a full sector or a seq jump starts the next one
+    if (!s_hasHead || s_headSlot >= RECORDS_PER_SECTOR || seq != s_headFirst + s_headSlot) {
+        uint32_t sector = s_hasHead ? (s_headSector + 1) % _sectorCount : 0;
+        if (!startSector(sector, s_hasHead ? s_headSeq + 1 : 0, seq)) {
+            s_valid = false;
+            return false;
+        }
+    }
+
+    history_record_t r;
+    r.timestamp = timestamp;
+    r.centiC = centiC;
+    r.flags = flags;
+    r.check = recordCheck(r);
+
+    size_t offset = sectorOffset(s_headSector) + sizeof(SectorHeader) + s_headSlot * sizeof(history_record_t);
+    s_headSlot++; // A failed write still uses the slot: it reads back as torn
+    if (esp_partition_write(_part, offset, &r, sizeof(r)) != ESP_OK) {
+        LOG_W("[HIST] Write failed for seq %u", seq);
+        return false;
+    }
+    return true;
+}
+
+uint32_t HistoryLog::sectorFor(uint32_t sectorSeq) const {
+    return (s_headSector + _sectorCount - (s_headSeq - sectorSeq) % _sectorCount) % _sectorCount;
+}
+
+bool HistoryLog::readFirstSample(uint32_t sectorSeq, uint32_t& firstSample) {
+    SectorHeader hdr;
+    if (esp_partition_read(_part, sectorOffset(sectorFor(sectorSeq)), &hdr, sizeof(hdr)) != ESP_OK ||
+        hdr.magic != SECTOR_MAGIC || hdr.seq != sectorSeq) {
+        return false;
+    }
+    firstSample = hdr.firstSample;
+    return true;
+}
+
+size_t HistoryLog::readSamples(uint32_t seq, history_record_t* out, size_t maxCount, uint32_t& firstSeq) {
+    if (!_part || !s_hasHead || maxCount == 0) {
+        return 0;
+    }
+
+    // Last sector starting at or before seq; first samples rise with the sector sequence
+    uint32_t lo = s_tailSeq, hi = s_headSeq;
+    uint32_t first;
+    if (!readFirstSample(lo, first)) {
+        return 0;
+    }
+    if (seq < first) {
+        seq = first; // Older samples were overwritten
+    }
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        uint32_t midFirst;
+        if (!readFirstSample(mid, midFirst)) {
+            return 0;
+        }
+        if (midFirst <= seq) {
+            lo = mid;
+            first = midFirst;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    // The sector holds samples up to the next sector's first seq, or the write position
+    uint32_t count = s_headSlot;
+    uint32_t nextFirst = 0;
+    if (lo != s_headSeq) {
+        if (!readFirstSample(lo + 1, nextFirst)) {
+            return 0;
+        }
+        count = (nextFirst - first < RECORDS_PER_SECTOR) ? nextFirst - first : RECORDS_PER_SECTOR;
+        if (seq - first >= count) {
+            return readSamples(nextFirst, out, maxCount, firstSeq); // seq was never stored
+        }
+    } else if (seq - first >= count) {
+        return 0;
+    }
+
+    uint32_t slot = seq - first;
+    size_t n = count - slot;
+    if (n > maxCount) n = maxCount;
+    size_t offset = sectorOffset(sectorFor(lo)) + sizeof(SectorHeader) + slot * sizeof(history_record_t);
+    if (esp_partition_read(_part, offset, out, n * sizeof(history_record_t)) != ESP_OK) {
+        return 0;
+    }
+    if (lo != s_headSeq && slot + n == count) {
+        // A sector left early by a seq jump ends in slots that never held a sample
+        while (n > 0 && isErased(out[n - 1])) {
+            n--;
+        }
+        if (n == 0) {
+            return readSamples(nextFirst, out, maxCount, firstSeq);
+        }
+    }
+    firstSeq = seq;
+    return n;
+}
+
+uint32_t HistoryLog::firstIndex() const {
+    return s_hasHead ? s_tailSeq * RECORDS_PER_SECTOR : 0;
+}
+
+uint32_t HistoryLog::nextIndex() const {
+    return s_hasHead ? s_headSeq * RECORDS_PER_SECTOR + s_headSlot : 0;
+}
+
+size_t HistoryLog::read(uint32_t index, history_record_t* out, size_t maxCount) {
+    if (!_part || !s_hasHead) {
+        return 0;
+    }
+    if (index < firstIndex()) {
+        index = firstIndex();
+    }
+
+    size_t n = 0;
+    while (n < maxCount && index < nextIndex()) {
+        uint32_t seq = index / RECORDS_PER_SECTOR;
+        uint32_t slot = index % RECORDS_PER_SECTOR;
+        // Sector holding this sequence, counted back from the head
+        uint32_t sector = sectorFor(seq);
+        // Read the rest of this sector's run in one go
+        size_t run = RECORDS_PER_SECTOR - slot;
+        if (run > maxCount - n) run = maxCount - n;
+        if (run > nextIndex() - index) run = nextIndex() - index;
+
+        size_t offset = sectorOffset(sector) + sizeof(SectorHeader) + slot * sizeof(history_record_t);
+        if (esp_partition_read(_part, offset, &out[n], run * sizeof(history_record_t)) != ESP_OK) {
+            break;
+        }
+        n += run;
+        index += run;
+    }
+    return n;
+}
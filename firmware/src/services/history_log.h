@@ -0,0 +1,73 @@
+#ifndef HISTORY_LOG_H
+#define HISTORY_LOG_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+// Persistent sample history on the "histlog" flash partition.
+//
+// The partition is a circular log of 4KB sectors. Each sector starts with a 12 byte header
+// (magic + sector sequence + sample seq of its first slot) followed by 510 fixed 8 byte
+// records, so a record's storage index is sectorSeq * 510 + slot and never repeats. Sectors
+// are erased one at a time just before reuse, which spreads erases evenly over the whole
+// partition (wear levelling without a mapping layer). The write position is cached in RTC
+// memory so wakes do not have to rescan flash.
+//
+// Sample sequence numbers (the uplink seq) are counted separately from storage, so they
+// keep advancing without a history partition and never repeat after power loss: the
+// counter lives in RTC memory and main reserves blocks of it in NVS, as for the beacon
+// nonce. Within a sector seqs are consecutive; a jump (power loss) starts a new sector.
+
+typedef struct {
+    uint32_t timestamp; // Device time (s)
+    int16_t centiC;     // 0.01C, INT16_MIN = sensor error
+    uint8_t flags;      // HISTORY_FLAG_*
+    uint8_t check;      // Checksum over the first 7 bytes
+} __attribute__((packed)) history_record_t;
+
+#define HISTORY_FLAG_ALARM 0x01 // Alarm was active when sampled
+#define HISTORY_SEQ_RESERVE 256 // Sample seqs per NVS write
+
+class HistoryLog {
+public:
+    bool begin();
+    bool isReady() const { return _part != nullptr; }
+
+    // Sample seq counter. After power-on, continue from the block last reserved in NVS.
+    void restoreSeq(uint32_t reserved);
+    bool isSeqRestored() const;
+    // True when main must persist getSeqReserve() and confirm it before the next takeSeq()
+    bool needsSeqReserve() const;
+    uint32_t getSeqReserve() const;
+    void confirmSeqReserve();
+    uint32_t takeSeq();
+
+    // Stores the sample under seq. A failed write still uses up its slot, so it reads back
+    // as a torn record rather than shifting later seqs.
+    bool append(uint32_t seq, uint32_t timestamp, int16_t centiC, uint8_t flags = 0);
+    // Reads the consecutive run of samples starting at the oldest stored seq >= seq, up to
+    // maxCount and never past a sector. firstSeq is the seq of out[0]. Returns the number read.
+    size_t readSamples(uint32_t seq, history_record_t* out, size_t maxCount, uint32_t& firstSeq);
+
+    // Storage order (BLE bulk download): valid record indices are [firstIndex(), nextIndex())
+    uint32_t firstIndex() const;
+    uint32_t nextIndex() const;
+    // Reads up to maxCount consecutive records starting at index (clamped to firstIndex()).
+    // Records torn by a reset mid-write fail isValid(). Returns the number read.
+    size_t read(uint32_t index, history_record_t* out, size_t maxCount);
+    static bool isValid(const history_record_t& r);
+
+private:
+    bool scan();
+    bool startSector(uint32_t sector, uint32_t seq, uint32_t firstSample);
+    uint32_t sectorOffset(uint32_t sector) const { return sector * 4096; }
+    uint32_t sectorFor(uint32_t sectorSeq) const;
+    bool readFirstSample(uint32_t sectorSeq, uint32_t& firstSample);
+
+    const esp_partition_t* _part = nullptr;
+    uint32_t _sectorCount = 0;
+};
+
+extern HistoryLog historyLog;
+
+#endif // HISTORY_LOG_H
@@ -0,0 +1,131 @@
+#include "link_control.h"
+#include "logger.h"
+
+LinkControl linkControl;
+
+static const wifi_phy_rate_t kRates[LINK_RATE_COUNT] = {
+    WIFI_PHY_RATE_LORA_250K, WIFI_PHY_RATE_LORA_500K, // LR only
+    WIFI_PHY_RATE_1M_L, WIFI_PHY_RATE_2M_L,
+    WIFI_PHY_RATE_6M, WIFI_PHY_RATE_12M, WIFI_PHY_RATE_24M, WIFI_PHY_RATE_54M,
+};
+static const char* kRateNames[LINK_RATE_COUNT] = {
+    "LR 250K", "LR 500K", "1M", "2M", "6M", "12M", "24M", "54M",
+};
+
+// Quarter-dBm steps for esp_wifi_set_max_tx_power(): 2 dBm ... 19.5 dBm
+static const int8_t kTxPowers[LINK_TXP_COUNT] = { 8, 20, 34, 44, 52, 60, 68, 78 };
+
+// Controller state, valid across deep sleep
+RTC_DATA_ATTR static uint8_t s_rate = LINK_RATE_FIRST_NON_LR;
+RTC_DATA_ATTR static uint8_t s_rateStreak = 0;
+RTC_DATA_ATTR static uint8_t s_txPower = LINK_TXP_COUNT - 1; // Start loud, work down
+RTC_DATA_ATTR static uint8_t s_txpStreak = 0;
+RTC_DATA_ATTR static uint32_t s_ackHistory = 0; // 1 bit per unicast, newest in bit 0
+RTC_DATA_ATTR static uint8_t s_ackSamples = 0;
+
+const char* LinkControl::rateName(uint8_t index) {
+    return index < LINK_RATE_COUNT ? kRateNames[index] : "auto";
+}
+
+void LinkControl::configure(uint8_t rate, bool longRange, int8_t txPower) {
+    _rateSetting = (rate < LINK_RATE_COUNT) ? rate : LINK_RATE_AUTO;
+    _longRange = longRange;
+    _txPowerSetting = (txPower <= 0) ? LINK_TXP_AUTO : constrain(txPower, kTxPowers[0], kTxPowers[LINK_TXP_COUNT - 1]);
+    if (_rateSetting != LINK_RATE_AUTO && _rateSetting < lowestRate()) {
+        _rateSetting = lowestRate(); // LR rates need LR mode
+    }
+    if (s_rate < lowestRate() || s_rate >= LINK_RATE_COUNT) {
+        s_rate = LINK_RATE_FIRST_NON_LR;
+    }
+    _dirty = true;
+}
+
+void LinkControl::begin() {
+    uint8_t protocol = WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N;
+    if (_longRange) {
+        protocol |= WIFI_PROTOCOL_LR;
+    }
+    esp_wifi_set_protocol(WIFI_IF_STA, protocol);
+    _dirty = true;
+    applyPending();
+}
+
+uint8_t LinkControl::getRate() const {
+    return _rateSetting == LINK_RATE_AUTO ? s_rate : _rateSetting;
+}
+
+void LinkControl::setRate(uint8_t index) {
+    if (index != s_rate) {
+        s_rate = index;
+        _dirty = true;
+    }
+}
+
+int8_t LinkControl::getTxPower() const {
+    return _txPowerSetting == LINK_TXP_AUTO ? kTxPowers[s_txPower] : _txPowerSetting;
+}
+
+void LinkControl::setTxPowerLevel(uint8_t level) {
+    if (level != s_txPower) {
+        s_txPower = level;
+        _dirty = true;
+    }
+}
+
+uint8_t LinkControl::getAckPercent() const {
+    if (s_ackSamples == 0) {
+        return 100;
+    }
+    uint32_t mask = (s_ackSamples >= 32) ? 0xFFFFFFFF : ((1UL << s_ackSamples) - 1);
+    return (uint8_t)(__builtin_popcount(s_ackHistory & mask) * 100 / s_ackSamples);
+}
+
+void LinkControl::onSendResult(bool acked) {
+    s_ackHistory = (s_ackHistory << 1) | (acked ? 1 : 0);
+    if (s_ackSamples < 32) {
+        s_ackSamples++;
+    }
+    bool autoRate = _rateSetting == LINK_RATE_AUTO;
+    bool autoPower = _txPowerSetting == LINK_TXP_AUTO;
+
+    if (!acked) {
+        s_rateStreak = 0;
+        s_txpStreak = 0;
+        if (autoPower && s_txPower < LINK_TXP_COUNT - 1) {
+            setTxPowerLevel(s_txPower + 2 < LINK_TXP_COUNT ? s_txPower + 2 : LINK_TXP_COUNT - 1);
+        } else if (autoRate && s_rate > lowestRate()) {
+            setRate(s_rate - 1);
+        }
+        return;
+    }
+    // Probe one step quieter / faster after a clean run; a failure there backs off again
+    if (autoPower && ++s_txpStreak >= LINK_TXP_DOWN_AFTER) {
+        s_txpStreak = 0;
+        if (s_txPower > 0) {
+            setTxPowerLevel(s_txPower - 1);
+        }
+    }
+    if (autoRate && ++s_rateStreak >= LINK_RATE_UP_AFTER) {
+        s_rateStreak = 0;
+        if (s_rate + 1 < LINK_RATE_COUNT) {
+            setRate(s_rate + 1);
+        }
+    }
+}
+
+void LinkControl::applyPending() {
+    if (!_dirty) {
+        return;
+    }
+    _dirty = false;
+    uint8_t rate = getRate();
+    if (esp_wifi_config_espnow_rate(WIFI_IF_STA, kRates[rate]) != ESP_OK) {
+        LOG_I("[LINK] Rate %s rejected", kRateNames[rate]);
+    }
+    if (esp_wifi_set_max_tx_power(getTxPower()) != ESP_OK) {
+        LOG_I("[LINK] TX power %d rejected", getTxPower());
+    }
+    LOG_I("[LINK] PHY rate %s%s, TX %.2f dBm%s", kRateNames[rate],
+                  _rateSetting == LINK_RATE_AUTO ? " (auto)" : "",
+                  getTxPower() / 4.0f, _txPowerSetting == LINK_TXP_AUTO ? " (auto)" : "");
+}
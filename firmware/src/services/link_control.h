@@ -0,0 +1,56 @@
+#ifndef LINK_CONTROL_H
+#define LINK_CONTROL_H
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+
+// ESP-NOW PHY rate selection. Rates form a ladder from most robust to fastest; the
+// LR (802.11 long range) rungs are only used when long-range mode is enabled, which
+// the gateway must also have on.
+//
+// Auto mode walks the ladder on unicast ACK results: one rung down per failed frame,
+// one rung up after LINK_RATE_UP_AFTER consecutive ACKs. State lives in RTC memory so
+// a sensor keeps its rate across deep sleep.
+//
+// TX power is closed-loop as well: one step down after LINK_TXP_DOWN_AFTER consecutive
+// ACKs, two steps up on a failure. Failures raise power first and only cost a rate rung
+// once power is maxed out, since a lower rate also means longer airtime.
+#define LINK_RATE_AUTO 0xFF
+#define LINK_RATE_COUNT 8
+#define LINK_RATE_FIRST_NON_LR 2
+#define LINK_RATE_UP_AFTER 10
+#define LINK_TXP_AUTO 0
+#define LINK_TXP_COUNT 8
+#define LINK_TXP_DOWN_AFTER 6
+
+class LinkControl {
+public:
+    // rate: ladder index (0 = LR 250K ... 7 = 54M) or LINK_RATE_AUTO
+    // txPower: LINK_TXP_AUTO or a fixed esp_wifi_set_max_tx_power() value (0.25 dBm units)
+    void configure(uint8_t rate, bool longRange, int8_t txPower = LINK_TXP_AUTO);
+    uint8_t getRateSetting() const { return _rateSetting; }
+    bool isLongRange() const { return _longRange; }
+    int8_t getTxPowerSetting() const { return _txPowerSetting; }
+
+    void begin();                     // After esp_now_init()
+    void onSendResult(bool acked);    // Unicast results only, from the send callback
+    void applyPending();              // Before each send
+    uint8_t getRate() const;          // Ladder index in use
+    int8_t getTxPower() const;        // 0.25 dBm units
+    uint8_t getAckPercent() const;    // Over the last (up to) 32 unicasts, 100 if none yet
+    static const char* rateName(uint8_t index);
+
+private:
+    uint8_t lowestRate() const { return _longRange ? 0 : LINK_RATE_FIRST_NON_LR; }
+    void setRate(uint8_t index);
+    void setTxPowerLevel(uint8_t level);
+
+    uint8_t _rateSetting = LINK_RATE_AUTO;
+    bool _longRange = false;
+    int8_t _txPowerSetting = LINK_TXP_AUTO;
+    volatile bool _dirty = true;
+};
+
+extern LinkControl linkControl;
+
+#endif // LINK_CONTROL_H
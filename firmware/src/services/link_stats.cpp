@@ -0,0 +1,86 @@
+#include "link_stats.h"
+
+LinkStats linkStats;
+
+// ACK latency bucket upper bounds (us); the last bucket is open ended
+static const uint32_t kLatencyBounds[TEMP_FRAME_DIAG_BUCKETS - 1] = { 2000, 5000, 10000, 20000, 50000 };
+
+RTC_DATA_ATTR static temp_frame_diag_t s_stats;
+RTC_DATA_ATTR static uint8_t s_consecutiveFails = 0;
+RTC_DATA_ATTR static int16_t s_rssiAvgX4 = 0; // EWMA, 0.25 dBm resolution
+RTC_DATA_ATTR static bool s_hasReported = false;
+RTC_DATA_ATTR static uint32_t s_lastReport = 0;
+RTC_DATA_ATTR static bool s_hasLinkReported = false;
+RTC_DATA_ATTR static temp_frame_link_t s_lastLink;
+
+static uint16_t saturatingInc(uint16_t counter) {
+    return counter < UINT16_MAX ? counter + 1 : counter;
+}
+
+void LinkStats::configure(uint32_t reportEverySec) {
+    _reportEverySec = reportEverySec;
+}
+
+void LinkStats::recordSend(bool acked, uint32_t latencyUs) {
+    s_stats.attempts = saturatingInc(s_stats.attempts);
+    if (!acked) {
+        if (s_consecutiveFails < 0xFF) s_consecutiveFails++;
+        if (s_consecutiveFails > s_stats.maxConsecutiveFails) {
+            s_stats.maxConsecutiveFails = s_consecutiveFails;
+        }
+        return;
+    }
+    s_consecutiveFails = 0;
+    s_stats.acked = saturatingInc(s_stats.acked);
+
+    int bucket = 0;
+    while (bucket < TEMP_FRAME_DIAG_BUCKETS - 1 && latencyUs >= kLatencyBounds[bucket]) {
+        bucket++;
+    }
+    if (s_stats.latency[bucket] < 0xFF) s_stats.latency[bucket]++;
+}
+
+void LinkStats::recordRetry() {
+    s_stats.retries = saturatingInc(s_stats.retries);
+}
+
+void LinkStats::recordRssi(int8_t rssi) {
+    if (s_stats.rssiLast == 0) {
+        s_rssiAvgX4 = rssi * 4; // First frame seeds the average
+    } else {
+        s_rssiAvgX4 += (rssi * 4 - s_rssiAvgX4) / 8;
+    }
+    s_stats.rssiLast = rssi;
+    s_stats.rssiAvg = (int8_t)(s_rssiAvgX4 / 4);
+}
+
+bool LinkStats::isReportDue(uint32_t now) const {
+    if (_reportEverySec == 0) {
+        return false;
+    }
+    return !s_hasReported || (now - s_lastReport) >= _reportEverySec;
+}
+
+void LinkStats::snapshot(temp_frame_diag_t& out) const {
+    out = s_stats;
+    out.consecutiveFails = s_consecutiveFails;
+}
+
+void LinkStats::markReported(uint32_t now) {
+    // RSSI is a level, not a counter: keep it
+    int8_t rssiLast = s_stats.rssiLast, rssiAvg = s_stats.rssiAvg;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.rssiLast = rssiLast;
+    s_stats.rssiAvg = rssiAvg;
+    s_hasReported = true;
+    s_lastReport = now;
+}
+
+bool LinkStats::isLinkReportDue(const temp_frame_link_t& link) const {
+    return !s_hasLinkReported || link.txPower != s_lastLink.txPower || link.phyRate != s_lastLink.phyRate;
+}
+
+void LinkStats::markLinkReported(const temp_frame_link_t& link) {
+    s_lastLink = link;
+    s_hasLinkReported = true;
+}
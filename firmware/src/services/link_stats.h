@@ -0,0 +1,33 @@
+#ifndef LINK_STATS_H
+#define LINK_STATS_H
+
+#include <Arduino.h>
+#include "temp_frame_codec.h"
+
+// Delivery and link-quality counters for the gateway link, kept in RTC memory across
+// deep sleep. Counters cover the period since the last diagnostics report and are
+// cleared once a frame carrying them has been ACKed.
+class LinkStats {
+public:
+    void configure(uint32_t reportEverySec); // 0 = never report
+    uint32_t getReportInterval() const { return _reportEverySec; }
+
+    void recordSend(bool acked, uint32_t latencyUs); // Unicast send callback
+    void recordRetry();
+    void recordRssi(int8_t rssi);                    // Frames received from the gateway
+
+    bool isReportDue(uint32_t now) const;
+    void snapshot(temp_frame_diag_t& out) const;
+    void markReported(uint32_t now);                 // Clears the counters
+
+    // TX power/rate changes since the gateway last got a link section (ACK% alone is not news)
+    bool isLinkReportDue(const temp_frame_link_t& link) const;
+    void markLinkReported(const temp_frame_link_t& link);
+
+private:
+    uint32_t _reportEverySec = 0;
+};
+
+extern LinkStats linkStats;
+
+#endif // LINK_STATS_H
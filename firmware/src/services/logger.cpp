@@ -0,0 +1,92 @@
+#include "logger.h"
+#include <stdarg.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+Logger logger;
+
+static portMUX_TYPE s_logMux = portMUX_INITIALIZER_UNLOCKED;
+static char s_ring[LOG_RING_SIZE];
+static size_t s_head = 0;     // Total bytes ever written
+static size_t s_drained = 0;  // Total bytes handed to Serial
+static TaskHandle_t s_drainTask = nullptr;
+
+void Logger::begin(bool serialOut) {
+    _serialOut = serialOut;
+    if (serialOut && !s_drainTask) {
+        xTaskCreate(drainTask, "log_drain", 2048, nullptr, tskIDLE_PRIORITY + 1, &s_drainTask);
+        xTaskNotifyGive(s_drainTask); // Lines logged before begin()
+    }
+}
+
+void Logger::write(char level, const char* fmt, ...) {
+    char line[LOG_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "%c %lu ", level, (unsigned long)millis());
+    va_list args;
+    va_start(args, fmt);
+    n += vsnprintf(line + n, sizeof(line) - n - 1, fmt, args);
+    va_end(args);
+    if (n > (int)sizeof(line) - 2) {
+        n = sizeof(line) - 2; // Truncated
+    }
+    line[n++] = '\n';
+
+    portENTER_CRITICAL(&s_logMux);
+    for (int i = 0; i < n; i++) {
+        s_ring[(s_head + i) % LOG_RING_SIZE] = line[i];
+    }
+    s_head += n;
+    portEXIT_CRITICAL(&s_logMux);
+
+    if (s_drainTask) {
+        xTaskNotifyGive(s_drainTask);
+    }
+}
+
+void Logger::drainTask(void* arg) {
+    char chunk[64];
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (;;) {
+            size_t len = 0;
+            portENTER_CRITICAL(&s_logMux);
+            if (s_head - s_drained > LOG_RING_SIZE) {
+                s_drained = s_head - LOG_RING_SIZE; // Overrun: the oldest lines are gone
+            }
+            while (len < sizeof(chunk) && s_drained + len < s_head) {
+                chunk[len] = s_ring[(s_drained + len) % LOG_RING_SIZE];
+                len++;
+            }
+            portEXIT_CRITICAL(&s_logMux);
+            if (len == 0) {
+                break;
+            }
+            Serial.write((const uint8_t*)chunk, len);
+            s_drained += len;
+        }
+    }
+}
+
+void Logger::flush(uint32_t timeoutMs) {
+    if (!_serialOut) {
+        return;
+    }
+    unsigned long start = millis();
+    while (s_drained < s_head && millis() - start < timeoutMs) {
+        delay(1);
+    }
+}
+
+size_t Logger::snapshot(char* out, size_t maxLen) {
+    portENTER_CRITICAL(&s_logMux);
+    size_t len = s_head < LOG_RING_SIZE ? s_head : LOG_RING_SIZE;
+    if (len > maxLen) {
+        len = maxLen;
+    }
+    size_t from = s_head - len;
+    for (size_t i = 0; i < len; i++) {
+        out[i] = s_ring[(from + i) % LOG_RING_SIZE];
+    }
+    portEXIT_CRITICAL(&s_logMux);
+    return len;
+}
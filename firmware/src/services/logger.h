@@ -0,0 +1,61 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+
+// Levelled logging. Messages above LOG_LEVEL compile to nothing (arguments are not
+// evaluated). Enabled messages are formatted into a RAM ring buffer and returned from
+// at once; a low-priority task copies the ring to Serial when serial output is on, and
+// the BLE log characteristic can read the newest part of it at any time.
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG // Release builds set LOG_LEVEL_WARN (see firmware/version.py)
+#endif
+
+#define LOG_RING_SIZE 2048
+#define LOG_LINE_MAX 160
+
+class Logger {
+public:
+    // serialOut false keeps messages in the ring only (no USB CDC traffic at all)
+    void begin(bool serialOut);
+    void write(char level, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+    // Waits (bounded) until the drain task has written everything, e.g. before deep sleep
+    void flush(uint32_t timeoutMs = 100);
+    // Copies the newest (up to maxLen) bytes of the ring, oldest first. Returns the length.
+    size_t snapshot(char* out, size_t maxLen);
+
+private:
+    static void drainTask(void* arg);
+    volatile bool _serialOut = false;
+};
+
+extern Logger logger;
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(fmt, ...) logger.write('E', fmt, ##__VA_ARGS__)
+#else
+#define LOG_E(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(fmt, ...) logger.write('W', fmt, ##__VA_ARGS__)
+#else
+#define LOG_W(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(fmt, ...) logger.write('I', fmt, ##__VA_ARGS__)
+#else
+#define LOG_I(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(fmt, ...) logger.write('D', fmt, ##__VA_ARGS__)
+#else
+#define LOG_D(fmt, ...) do {} while (0)
+#endif
+
+#endif // LOGGER_H
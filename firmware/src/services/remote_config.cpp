@@ -0,0 +1,94 @@
+#include "remote_config.h"
+#include <freertos/FreeRTOS.h>
+
+RemoteConfig remoteConfig;
+
+static portMUX_TYPE s_queueMux = portMUX_INITIALIZER_UNLOCKED;
+static struct_message_config_cmd s_queue[CONFIG_QUEUE_LEN];
+static volatile uint8_t s_head = 0; // Next to pop
+static volatile uint8_t s_count = 0;
+
+// Recently applied seqs: a retransmit can trail up to a full batch of newer commands
+RTC_DATA_ATTR static uint8_t s_recentSeqs[CONFIG_QUEUE_LEN];
+RTC_DATA_ATTR static uint8_t s_recentCount = 0;
+RTC_DATA_ATTR static uint8_t s_recentNext = 0;
+
+void RemoteConfig::openWindow(uint32_t baseMs) {
+    _windowStart = millis();
+    _windowMs = baseMs;
+}
+
+bool RemoteConfig::isWindowOpen() const {
+    return s_count > 0 || millis() - _windowStart < _windowMs;
+}
+
+uint32_t RemoteConfig::remainingMs() const {
+    if (s_count > 0) {
+        return 0;
+    }
+    uint32_t elapsed = millis() - _windowStart;
+    return elapsed < _windowMs ? _windowMs - elapsed : 0;
+}
+
+bool RemoteConfig::onReceive(const uint8_t* data, int len) {
+    if (len != sizeof(struct_message_config_cmd)) {
+        return false;
+    }
+    struct_message_config_cmd cmd;
+    memcpy(&cmd, data, sizeof(cmd));
+    if (cmd.messageID != 113) {
+        return false;
+    }
+
+    if (cmd.more) {
+        uint32_t extended = millis() - _windowStart + CONFIG_WINDOW_EXTEND_MS;
+        if (extended > CONFIG_WINDOW_MAX_MS) {
+            extended = CONFIG_WINDOW_MAX_MS;
+        }
+        if (extended > _windowMs) {
+            _windowMs = extended;
+        }
+    }
+    if (cmd.command == CONFIG_CMD_NONE) {
+        return true; // Keep-alive: only holds the window open
+    }
+
+    portENTER_CRITICAL(&s_queueMux);
+    if (s_count < CONFIG_QUEUE_LEN) {
+        s_queue[(s_head + s_count) % CONFIG_QUEUE_LEN] = cmd;
+        s_count++;
+    }
+    // Full: dropped unacknowledged, the gateway resends it
+    portEXIT_CRITICAL(&s_queueMux);
+    return true;
+}
+
+bool RemoteConfig::pop(struct_message_config_cmd& cmd) {
+    bool found = false;
+    portENTER_CRITICAL(&s_queueMux);
+    if (s_count > 0) {
+        cmd = s_queue[s_head];
+        s_head = (s_head + 1) % CONFIG_QUEUE_LEN;
+        s_count--;
+        found = true;
+    }
+    portEXIT_CRITICAL(&s_queueMux);
+    return found;
+}
+
+bool RemoteConfig::isDuplicate(uint8_t seq) const {
+    for (uint8_t i = 0; i < s_recentCount; i++) {
+        if (s_recentSeqs[i] == seq) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RemoteConfig::markApplied(uint8_t seq) {
+    s_recentSeqs[s_recentNext] = seq;
+    s_recentNext = (s_recentNext + 1) % CONFIG_QUEUE_LEN;
+    if (s_recentCount < CONFIG_QUEUE_LEN) {
+        s_recentCount++;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef REMOTE_CONFIG_H
+#define REMOTE_CONFIG_H
+
+#include <Arduino.h>
+#include "shared_defs.h"
+
+// Downlink configuration window. After an uplink the sensor listens briefly for
+// struct_message_config_cmd frames from the gateway. The window only grows when a command
+// arrives with `more` set (further commands queued at the gateway), so sensors with nothing
+// pending pay for the base window alone. Commands are queued from the recv callback and
+// applied from the main task, where NVS writes are safe.
+#define CONFIG_WINDOW_EXTEND_MS 60 // Per command flagged `more`
+#define CONFIG_WINDOW_MAX_MS 1000  // Hard cap from the start of the window
+#define CONFIG_QUEUE_LEN 4
+
+class RemoteConfig {
+public:
+    void openWindow(uint32_t baseMs);
+    bool isWindowOpen() const; // Until the deadline, and while commands wait to be applied
+    uint32_t remainingMs() const; // Time left to wait for commands; 0 once closed or when one is queued
+
+    // From the recv callback. False if the frame is not a config command.
+    bool onReceive(const uint8_t* data, int len);
+    bool pop(struct_message_config_cmd& cmd);
+
+    // Gateways resend unacknowledged commands: only the first copy is applied. The last
+    // CONFIG_QUEUE_LEN applied seqs are remembered, so seqs must not wrap within that window.
+    bool isDuplicate(uint8_t seq) const;
+    void markApplied(uint8_t seq);
+
+private:
+    uint32_t _windowStart = 0;
+    volatile uint32_t _windowMs = 0;
+};
+
+extern RemoteConfig remoteConfig;
+
+#endif // REMOTE_CONFIG_H
@@ -0,0 +1,39 @@
+#include "report_policy.h"
+
+ReportPolicy reportPolicy;
+
+RTC_DATA_ATTR static bool s_hasReported = false;
+RTC_DATA_ATTR static float s_lastTemp = 0.0f;
+RTC_DATA_ATTR static uint32_t s_lastTime = 0;
+
+void ReportPolicy::configure(float deadbandC, uint32_t heartbeatSec) {
+    _deadbandC = (isnan(deadbandC) || deadbandC < 0.0f) ? 0.0f : deadbandC;
+    _heartbeatSec = heartbeatSec;
+}
+
+bool ReportPolicy::shouldReport(float temp, uint32_t now) const {
+    if (!isEnabled() || !s_hasReported) {
+        return true;
+    }
+    // Sensor errors and recoveries are always worth a frame
+    if (isnan(temp) != isnan(s_lastTemp)) {
+        return true;
+    }
+    if (!isnan(temp) && fabsf(temp - s_lastTemp) > _deadbandC) {
+        return true;
+    }
+    return isHeartbeatDue(now);
+}
+
+bool ReportPolicy::isHeartbeatDue(uint32_t now) const {
+    return _heartbeatSec > 0 && (now - s_lastTime) >= _heartbeatSec;
+}
+
+void ReportPolicy::markReported(float temp, uint32_t now) {
+    if (s_hasReported && (int32_t)(now - s_lastTime) < 0) {
+        return;
+    }
+    s_hasReported = true;
+    s_lastTemp = temp;
+    s_lastTime = now;
+}
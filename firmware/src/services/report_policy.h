@@ -0,0 +1,28 @@
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include <Arduino.h>
+
+// Report-on-change: a sample is queued for uplink only when it moved more than the
+// deadband from the last reported value, or when the heartbeat interval has passed.
+// Last reported value/time live in RTC memory.
+class ReportPolicy {
+public:
+    void configure(float deadbandC, uint32_t heartbeatSec); // deadband 0 = report every sample
+    bool isEnabled() const { return _deadbandC > 0.0f; }
+    float getDeadband() const { return _deadbandC; }
+    uint32_t getHeartbeat() const { return _heartbeatSec; }
+
+    bool shouldReport(float temp, uint32_t now) const;
+    bool isHeartbeatDue(uint32_t now) const;
+    // Readings older than the last one reported (backlog replay) leave the reference alone
+    void markReported(float temp, uint32_t now);
+
+private:
+    float _deadbandC = 0.0f;
+    uint32_t _heartbeatSec = 0;
+};
+
+extern ReportPolicy reportPolicy;
+
+#endif // REPORT_POLICY_H
@@ -0,0 +1,82 @@
+#include "sample_buffer.h"
+#include <sys/time.h>
+
+SampleBuffer sampleBuffer;
+
+// Zeroed by the loader on power-on, preserved across deep sleep
+RTC_DATA_ATTR static TempSample s_samples[SAMPLE_BUFFER_CAPACITY];
+RTC_DATA_ATTR static uint8_t s_head = 0;  // Next write slot
+RTC_DATA_ATTR static uint8_t s_count = 0;
+RTC_DATA_ATTR static bool s_overflow = false;
+RTC_DATA_ATTR static uint32_t s_overflowFrom = 0; // Oldest undelivered seq no longer in RAM
+
+uint32_t SampleBuffer::now() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint32_t)tv.tv_sec;
+}
+
+void SampleBuffer::push(float temp, uint32_t seq) {
+    TempSample& s = s_samples[s_head];
+    if (s_count == SAMPLE_BUFFER_CAPACITY && !s_overflow) {
+        s_overflow = true;
+        s_overflowFrom = s.seq;
+    }
+    s.timestamp = now();
+    s.seq = seq;
+    s.centiC = isnan(temp) ? INT16_MIN : (int16_t)lroundf(temp * 100.0f); // INT16_MIN = TEMP_FRAME_INVALID_TEMP
+    s.reserved = 0;
+
+    s_head = (s_head + 1) % SAMPLE_BUFFER_CAPACITY;
+    if (s_count < SAMPLE_BUFFER_CAPACITY) {
+        s_count++;
+    }
+}
+
+uint8_t SampleBuffer::count() const {
+    return s_count;
+}
+
+bool SampleBuffer::isFull() const {
+    return s_count >= SAMPLE_BUFFER_CAPACITY;
+}
+
+bool SampleBuffer::peek(uint8_t index, TempSample& out) const {
+    if (index >= s_count) {
+        return false;
+    }
+    uint8_t tail = (s_head + SAMPLE_BUFFER_CAPACITY - s_count) % SAMPLE_BUFFER_CAPACITY;
+    out = s_samples[(tail + index) % SAMPLE_BUFFER_CAPACITY];
+    return true;
+}
+
+void SampleBuffer::drop(uint8_t n) {
+    s_count = (n >= s_count) ? 0 : s_count - n;
+    if (s_count == 0) {
+        s_overflow = false; // Overflow is always replayed before the RAM samples
+    }
+}
+
+void SampleBuffer::clear() {
+    s_count = 0;
+    s_overflow = false;
+}
+
+bool SampleBuffer::getOverflow(uint32_t& from, uint32_t& to) const {
+    TempSample oldest;
+    if (!s_overflow || !peek(0, oldest)) {
+        return false;
+    }
+    from = s_overflowFrom;
+    to = oldest.seq;
+    return from < to;
+}
+
+void SampleBuffer::ackOverflow(uint32_t seq) {
+    TempSample oldest;
+    if (!peek(0, oldest) || seq >= oldest.seq) {
+        s_overflow = false;
+    } else if (seq > s_overflowFrom) {
+        s_overflowFrom = seq;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef SAMPLE_BUFFER_H
+#define SAMPLE_BUFFER_H
+
+#include <Arduino.h>
+
+// Samples kept across deep sleep (RTC slow memory is 8KB on the C3, this uses ~0.8KB)
+#define SAMPLE_BUFFER_CAPACITY 64
+
+typedef struct {
+    uint32_t timestamp; // Device time in seconds (RTC clock, keeps running through deep sleep)
+    uint32_t seq;       // Uplink sequence number of the reading
+    int16_t centiC;     // Temperature in 0.01C
+    uint16_t reserved;
+} TempSample;
+
+// Ring buffer of unsent samples in RTC memory. When full the oldest sample is overwritten;
+// the overwritten range is remembered so it can be replayed from the flash history log.
+class SampleBuffer {
+public:
+    void push(float temp, uint32_t seq);
+    uint8_t count() const;
+    bool isFull() const;
+    // index 0 = oldest
+    bool peek(uint8_t index, TempSample& out) const;
+    // Drop the n oldest samples once they have been delivered
+    void drop(uint8_t n);
+    void clear();
+
+    // Seq range [from, to) that fell out of RAM before delivery
+    bool getOverflow(uint32_t& from, uint32_t& to) const;
+    // Marks overflowed samples before seq as delivered (or lost)
+    void ackOverflow(uint32_t seq);
+
+    static uint32_t now();
+};
+
+extern SampleBuffer sampleBuffer;
+
+#endif // SAMPLE_BUFFER_H
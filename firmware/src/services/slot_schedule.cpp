@@ -0,0 +1,65 @@
+#include "slot_schedule.h"
+#include <sys/time.h>
+#include "clock_cal.h"
+
+SlotSchedule slotSchedule;
+
+RTC_DATA_ATTR static uint32_t s_periodMs = 0;   // 0 = unscheduled
+RTC_DATA_ATTR static uint64_t s_anchorMs = 0;   // Start of one of our slots (device time)
+RTC_DATA_ATTR static uint64_t s_targetMs = 0;   // Slot the current wake is aimed at, 0 = none
+RTC_DATA_ATTR static int32_t s_leadMs = SLOT_LEAD_INIT_MS;
+
+uint64_t SlotSchedule::nowMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+void SlotSchedule::assign(uint32_t periodMs, uint32_t slotInMs) {
+    s_periodMs = periodMs;
+    s_anchorMs = nowMs() + slotInMs;
+    if (periodMs == 0) {
+        s_targetMs = 0;
+    }
+}
+
+bool SlotSchedule::isActive() const {
+    return s_periodMs != 0;
+}
+
+uint32_t SlotSchedule::alignSleep(uint32_t sleepMs) {
+    if (!isActive()) {
+        s_targetMs = 0;
+        return sleepMs;
+    }
+    // The gateway's slot grid in local (slow clock) time; sleepMs is already local
+    int64_t period = clockCal.toLocalMs(s_periodMs);
+    uint64_t now = nowMs();
+    uint64_t desired = now + sleepMs;
+    // Nearest slot start to the desired wake (anchor may be in the past or the future)
+    int64_t k = ((int64_t)(desired - s_anchorMs) + period / 2) / period;
+    if (desired < s_anchorMs) {
+        k = -(int64_t)((s_anchorMs - desired + period / 2) / period);
+    }
+    uint64_t slot = s_anchorMs + k * period;
+    while (slot < now + s_leadMs + SLOT_MIN_SLEEP_MS) {
+        slot += period;
+    }
+    s_targetMs = slot;
+    return (uint32_t)(slot - s_leadMs - now);
+}
+
+void SlotSchedule::waitForSlot() {
+    if (!isActive() || s_targetMs == 0) {
+        return;
+    }
+    uint64_t now = nowMs();
+    int32_t errorMs = (int32_t)(now - s_targetMs); // > 0: late, < 0: early
+    if (errorMs < 0 && -errorMs <= SLOT_LEAD_MAX_MS) {
+        delay(-errorMs);
+    }
+    // Late wakes need more lead; early ones waste awake time, so trim gently
+    s_leadMs += (errorMs > 0) ? errorMs : errorMs / 4;
+    s_leadMs = constrain(s_leadMs, 0, SLOT_LEAD_MAX_MS);
+    s_targetMs = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef SLOT_SCHEDULE_H
+#define SLOT_SCHEDULE_H
+
+#include <Arduino.h>
+
+// Time-slotted uplinks. The gateway assigns each sensor a repeating slot
+// (struct_message_slot_assign) relative to the moment the downlink is received, so no
+// shared clock is needed. Sleep durations are snapped to that slot grid, and the wake is
+// brought forward by a lead time that tracks how long the sensor needs from wake to TX.
+// Each transmit measures its error against the slot and corrects the lead; every fresh
+// assignment re-anchors the grid, which cancels slow-clock drift against the gateway.
+#define SLOT_LEAD_INIT_MS 80
+#define SLOT_LEAD_MAX_MS 1000
+#define SLOT_MIN_SLEEP_MS 1000
+
+class SlotSchedule {
+public:
+    // From the recv callback. periodMs 0 cancels the schedule.
+    void assign(uint32_t periodMs, uint32_t slotInMs);
+    bool isActive() const;
+
+    // Returns the sleep duration that wakes us one lead time ahead of the slot
+    // nearest to sleepMs from now. Both are in local (slow clock) ms.
+    uint32_t alignSleep(uint32_t sleepMs);
+    // Holds off until the slot this wake was aimed at opens, and learns from the error.
+    void waitForSlot();
+
+    static uint64_t nowMs(); // Device time, keeps counting through deep sleep
+};
+
+extern SlotSchedule slotSchedule;
+
+#endif // SLOT_SCHEDULE_H
@@ -0,0 +1,60 @@
+#include "temp_alarm.h"
+#include "logger.h"
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+
+TempAlarm tempAlarm;
+
+RTC_DATA_ATTR static bool s_alarmActive = false;
+
+void TempAlarm::configure(float low, float high) {
+    _low = low;
+    _high = high;
+    if (!isArmed()) {
+        s_alarmActive = false;
+    }
+}
+
+bool TempAlarm::isArmed() const {
+    return !isnan(_low) && !isnan(_high) && _low < _high;
+}
+
+bool TempAlarm::evaluate(float temp) {
+    if (!isArmed() || isnan(temp)) {
+        return false;
+    }
+    bool active = s_alarmActive ? (temp >= _low) : (temp >= _high);
+    return update(active);
+}
+
+bool TempAlarm::update(bool active) {
+    bool changed = (active != s_alarmActive);
+    s_alarmActive = active;
+    return changed;
+}
+
+bool TempAlarm::isActive() const {
+    return s_alarmActive;
+}
+
+void TempAlarm::armWakeup(int pin) {
+    if (pin < 0 || !isArmed()) {
+        return;
+    }
+    if (!esp_sleep_is_valid_wakeup_gpio((gpio_num_t)pin)) {
+        LOG_E("[ALARM] GPIO%d cannot wake from deep sleep", pin);
+        return;
+    }
+
+    // ALERT is open-drain, active low
+    gpio_config_t io_conf = {};
+    io_conf.intr_type = GPIO_INTR_DISABLE;
+    io_conf.mode = GPIO_MODE_INPUT;
+    io_conf.pin_bit_mask = (1ULL << pin);
+    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
+    gpio_config(&io_conf);
+
+    esp_deep_sleep_enable_gpio_wakeup(1ULL << pin,
+        s_alarmActive ? ESP_GPIO_WAKEUP_GPIO_HIGH : ESP_GPIO_WAKEUP_GPIO_LOW);
+}
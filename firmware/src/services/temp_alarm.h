@@ -0,0 +1,32 @@
+#ifndef TEMP_ALARM_H
+#define TEMP_ALARM_H
+
+#include <Arduino.h>
+
+// Threshold alarm state shared by the TMP102 ALERT wake and the software check.
+// The active/cleared state lives in RTC memory so transitions are detected across deep sleep.
+class TempAlarm {
+public:
+    void configure(float low, float high); // NAN on either side disables the alarm
+    bool isArmed() const;
+    float getLow() const { return _low; }
+    float getHigh() const { return _high; }
+
+    // Apply hysteresis to a reading (trip at >= high, clear at < low). Returns true on a transition.
+    bool evaluate(float temp);
+    // Force the state (e.g. from the sensor's AL bit on an ALERT wake). Returns true on a transition.
+    bool update(bool active);
+    bool isActive() const;
+
+    // Arm the ALERT pin as a deep-sleep wake source. Waits for the edge that ends the current
+    // state: asserted (LOW) while clear, released (HIGH) while active. Pin < 0 = not routed.
+    void armWakeup(int pin);
+
+private:
+    float _low = NAN;
+    float _high = NAN;
+};
+
+extern TempAlarm tempAlarm;
+
+#endif // TEMP_ALARM_H
@@ -0,0 +1,100 @@
+#include "temp_stats.h"
+
+TempStats tempStats;
+
+typedef struct {
+    uint32_t start;
+    int32_t sumC; // Fits 65535 samples at any TMP102 reading
+    int16_t minC;
+    int16_t maxC;
+    uint16_t count;
+    uint32_t secondsAbove;
+} StatsWindow;
+
+static const uint32_t s_windowSec[TempStats::WINDOW_COUNT] = { 3600, 86400, 3600, 86400 };
+
+RTC_DATA_ATTR static StatsWindow s_windows[TempStats::WINDOW_COUNT];
+RTC_DATA_ATTR static bool s_started = false;
+RTC_DATA_ATTR static bool s_hasLast = false;
+RTC_DATA_ATTR static bool s_lastAbove = false;
+RTC_DATA_ATTR static uint32_t s_lastTime = 0;
+
+static void resetWindow(StatsWindow& w, uint32_t start) {
+    w.start = start;
+    w.sumC = 0;
+    w.minC = INT16_MAX;
+    w.maxC = INT16_MIN;
+    w.count = 0;
+    w.secondsAbove = 0;
+}
+
+// Starts a new current window once `now` leaves it; the finished one becomes the LAST_* window
+static void rollWindow(StatsWindow& current, StatsWindow& last, uint32_t len, uint32_t now) {
+    uint32_t start = now - now % len;
+    if (s_started && current.start == start) {
+        return;
+    }
+    if (s_started && current.start + len == start) {
+        last = current;
+    } else {
+        // First sample, a gap of more than a window or a clock change: nothing to carry over
+        resetWindow(last, start - len);
+    }
+    resetWindow(current, start);
+}
+
+void TempStats::addSample(float temp, uint32_t now, float highThreshold) {
+    rollWindow(s_windows[HOUR], s_windows[LAST_HOUR], s_windowSec[HOUR], now);
+    rollWindow(s_windows[DAY], s_windows[LAST_DAY], s_windowSec[DAY], now);
+    s_started = true;
+
+    // Time above threshold: credit the interval since the previous sample if that one was above
+    if (s_hasLast && s_lastAbove && now > s_lastTime) {
+        for (int i = HOUR; i <= DAY; i++) {
+            uint32_t dt = now - s_lastTime;
+            uint32_t inWindow = now - s_windows[i].start;
+            s_windows[i].secondsAbove += dt < inWindow ? dt : inWindow;
+        }
+    }
+    s_hasLast = true;
+    s_lastTime = now;
+    s_lastAbove = !isnan(temp) && !isnan(highThreshold) && temp >= highThreshold; // Same test as the alarm
+
+    if (isnan(temp)) {
+        return;
+    }
+    int16_t centiC = (int16_t)lroundf(temp * 100.0f);
+    for (int i = HOUR; i <= DAY; i++) {
+        StatsWindow& w = s_windows[i];
+        if (w.count == UINT16_MAX) {
+            continue;
+        }
+        w.sumC += centiC;
+        if (centiC < w.minC) w.minC = centiC;
+        if (centiC > w.maxC) w.maxC = centiC;
+        w.count++;
+    }
+}
+
+bool TempStats::hasData() const {
+    return s_started && s_windows[DAY].count > 0;
+}
+
+bool TempStats::get(Window window, temp_frame_aggregate_t& out) const {
+    StatsWindow w = s_windows[window];
+    if (!s_started) {
+        resetWindow(w, 0);
+    }
+    out.windowStart = w.start;
+    out.windowSec = s_windowSec[window];
+    out.count = w.count;
+    out.secondsAbove = w.secondsAbove;
+    if (w.count == 0) {
+        out.minC = out.maxC = out.meanC = TEMP_FRAME_INVALID_TEMP;
+        return false;
+    }
+    out.minC = w.minC;
+    out.maxC = w.maxC;
+    out.meanC = (int16_t)(w.sumC / (int32_t)w.count);
+    return true;
+}
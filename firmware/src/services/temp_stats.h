@@ -0,0 +1,23 @@
+#ifndef TEMP_STATS_H
+#define TEMP_STATS_H
+
+#include <Arduino.h>
+#include "temp_frame_codec.h"
+
+// Rolling hourly/daily aggregates (min, max, mean, count, time at/above the alarm high
+// threshold), updated incrementally per sample and kept in RTC memory across deep sleep.
+// Windows are aligned to device time, so they are only wall-clock aligned once the
+// clock has been set.
+class TempStats {
+public:
+    enum Window { HOUR, DAY, LAST_HOUR, LAST_DAY, WINDOW_COUNT };
+
+    void addSample(float temp, uint32_t now, float highThreshold);
+    bool hasData() const;
+    // Fills out for the window, returns false if it holds no samples
+    bool get(Window window, temp_frame_aggregate_t& out) const;
+};
+
+extern TempStats tempStats;
+
+#endif // TEMP_STATS_H
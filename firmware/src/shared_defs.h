@@ -36,6 +36,30 @@ typedef struct {
   uint8_t nullPad;
 } __attribute__((packed)) victronManufacturerData;
 
+// Encrypted advertising beacon (temp sensor). Same framing as victronManufacturerData:
+// unknownData1 holds the product ID (LE) and record version. victronEncryptedData starts
+// with the key epoch (uint16 LE, clear) followed by the AES-128-CTR encrypted
+// ae_beacon_temp_record (counter block = nonceDataCounter, little endian, zero padded).
+// The epoch key is AES-128-ECB(pairing key, AE_BEACON_KEY_LABEL | epoch LE | zeros), and
+// encryptKeyMatch is its first byte. The epoch steps each time nonceDataCounter wraps, so
+// a (key, counter) pair is never reused and the pairing key (the ESP-NOW LMK) never
+// encrypts beacon data itself. Only the used bytes are sent.
+#define AE_BEACON_VENDOR_ID 0x02E5   // Espressif company ID
+#define AE_BEACON_TYPE 0x10          // Product advertisement
+#define AE_BEACON_PRODUCT_TEMP 0xAE22
+#define AE_BEACON_RECORD_TEMP 0x02   // Record version 2: epoch keys
+#define AE_BEACON_KEY_LABEL "AEBK"
+#define AE_BEACON_FLAG_ALARM 0x01    // Temperature at/above T_HIGH
+#define AE_BEACON_FLAG_SENSOR_FAULT 0x02
+
+typedef struct {
+  int16_t centiC;        // INT16_MIN = no reading
+  uint16_t batteryMv;
+  uint8_t batteryLevel;
+  uint8_t flags;
+  uint32_t seq;          // Sample sequence number, lets scanners drop repeats
+} __attribute__((packed)) ae_beacon_temp_record;
+
 typedef struct {
    uint8_t deviceState;
    uint8_t outputState;
@@ -132,6 +156,18 @@ typedef struct struct_message_temp_sensor {
   char firmwareVersion[12];
 } __attribute__((packed)) struct_message_temp_sensor;
 
+// Threshold alarm, sent ahead of the regular frame when the sensor trips or clears
+typedef struct struct_message_temp_alarm {
+  uint8_t id; // 23
+  float temperature;
+  float thresholdLow;
+  float thresholdHigh;
+  uint8_t active; // 1 = at/above T_HIGH, 0 = cleared below T_LOW
+  char name[32];
+} __attribute__((packed)) struct_message_temp_alarm;
+
+// Batched readings: see temp_frame_codec.h (id 25, versioned, delta/varint encoded)
+
 typedef struct struct_message_add_peer {
   int messageID; // 200
   uint8_t mac[6];
@@ -163,6 +199,55 @@ typedef struct struct_message_ota_trigger {
   bool force; // New Flag
 } __attribute__((packed)) struct_message_ota_trigger;
 
+// Uplink slot assignment (from Gateway to Child), sent in the post-uplink listen window.
+// The slot starts slotInMs after reception and repeats every periodMs (0 = unscheduled).
+typedef struct struct_message_slot_assign {
+  int messageID; // 111
+  uint32_t periodMs;
+  uint32_t slotInMs;
+} __attribute__((packed)) struct_message_slot_assign;
+
+// Gateway time reference (from Gateway to Child) for slow-clock calibration.
+// Sent in the post-uplink listen window; gatewayMs is the gateway's millis() at send time.
+typedef struct struct_message_time_sync {
+  int messageID; // 112
+  uint32_t gatewayMs;
+} __attribute__((packed)) struct_message_time_sync;
+
+// Remote configuration (from Gateway to Child), sent in the post-uplink listen window.
+// Set `more` while further commands are queued so the sensor keeps listening; a
+// CONFIG_CMD_NONE command with `more` set just holds the window open.
+#define CONFIG_CMD_NONE 0
+#define CONFIG_CMD_INTERVAL 1 // value: uint32_t sleep interval in ms
+#define CONFIG_CMD_DEADBAND 2 // value: float deadband in C, uint32_t heartbeat in s
+#define CONFIG_CMD_TX_POWER 3 // value: int8_t in 0.25 dBm, 0 = adaptive
+#define CONFIG_CMD_NAME 4     // value: name suffix, NUL terminated
+#define CONFIG_CMD_UNPAIR 5   // no value: wipes pairing and settings
+#define CONFIG_CMD_FEATURES 6 // value: uint8_t GATEWAY_FEATURE_* bits this gateway decodes
+
+// Gateway capabilities. Without GATEWAY_FEATURE_BATCH_FRAMES (and with batch size 1) the
+// sensor only sends frames every gateway understands (ids 22/23).
+#define GATEWAY_FEATURE_BATCH_FRAMES 0x01 // temp_frame_codec.h frames (id 25), backlog replay
+
+typedef struct struct_message_config_cmd {
+  int messageID; // 113
+  uint8_t seq;   // Echoed in the ack, repeats are acked but not re-applied
+  uint8_t command;
+  uint8_t more;
+  uint8_t value[32];
+} __attribute__((packed)) struct_message_config_cmd;
+
+#define CONFIG_STATUS_OK 0
+#define CONFIG_STATUS_INVALID 1 // Value out of range
+#define CONFIG_STATUS_UNKNOWN 2 // Command not supported by this firmware
+
+typedef struct struct_message_config_ack {
+  int messageID; // 114
+  uint8_t seq;
+  uint8_t command;
+  uint8_t status;
+} __attribute__((packed)) struct_message_config_ack;
+
 // Backward Compatibility
 typedef struct_message_temp_sensor struct_message_ae_temp_sensor;
 
@@ -0,0 +1,334 @@
+#ifndef TEMP_FRAME_CODEC_H
+#define TEMP_FRAME_CODEC_H
+
+// Compact batch telemetry frame (Temp Sensor -> Gateway).
+// Plain C++ with no Arduino dependencies so the gateway firmware can include it as-is.
+//
+// Layout (little endian):
+//   [0]     id          TEMP_FRAME_ID
+//   [1]     version     TEMP_FRAME_VERSION
+//   [2]     flags       TEMP_FRAME_FLAG_*, optional sections follow the samples
+//   [3]     hwVersion
+//   [4..7]  deviceTime  sender clock at send (s), sample times are relative to it
+//   [8..9]  intervalSec nominal sampling interval (s)
+//   [10]    count       number of samples
+//   [11..14] firstSeq   sequence number of the first sample
+//   samples, oldest first:
+//     first:  varint(deviceTime - t0), zigzag varint(centiC0)
+//     others: [varint(seq[i] - seq[i-1] - 1)], zigzag varint((t[i] - t[i-1]) - intervalSec),
+//             zigzag varint(centiC[i] - centiC[i-1])
+//     The seq gap is only present with TEMP_FRAME_FLAG_SEQ_GAPS, otherwise sequence numbers
+//     are consecutive.
+//   optional sections, in flag bit order:
+//     TEMP_FRAME_FLAG_AGGREGATES: u8 n, n x temp_frame_aggregate_t (current hour, current day)
+//     TEMP_FRAME_FLAG_LINK:       temp_frame_link_t
+//     TEMP_FRAME_FLAG_DIAG:       temp_frame_diag_t
+//
+// Steady sampling costs ~2 bytes per reading, so 100+ readings fit in one ESP-NOW frame.
+//
+// Sequence numbers count the sensor's readings: unique per reading and persistent across
+// power loss (reserved in NVS blocks, so they may jump after a reset). Frames are resent when an ACK is lost and backlogs are replayed after
+// outages, so the gateway should drop any (sensor, seq) it has already stored.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define TEMP_FRAME_ID 25
+#define TEMP_FRAME_VERSION 2
+#define TEMP_FRAME_MAX_LEN 250 // ESP-NOW payload limit
+#define TEMP_FRAME_HEADER_LEN 15
+#define TEMP_FRAME_INVALID_TEMP INT16_MIN // Sensor read failed
+
+#define TEMP_FRAME_FLAG_AGGREGATES 0x01
+#define TEMP_FRAME_FLAG_SEQ_GAPS 0x02 // Per-sample seq deltas (deadband-filtered samples)
+#define TEMP_FRAME_FLAG_LINK 0x04
+#define TEMP_FRAME_FLAG_DIAG 0x08
+
+typedef struct {
+    uint8_t flags;
+    uint8_t hardwareVersion;
+    uint32_t deviceTime;
+    uint16_t intervalSec;
+    uint8_t count;
+    uint32_t firstSeq;
+} temp_frame_header_t;
+
+typedef struct {
+    uint32_t timestamp; // Sender device time (s)
+    uint32_t seq;
+    int16_t centiC;
+} temp_frame_sample_t;
+
+// On-device rollup over one window (centi-degrees, device time)
+typedef struct __attribute__((packed)) {
+    uint32_t windowStart;
+    uint32_t windowSec;    // 3600 = hourly, 86400 = daily
+    int16_t minC;
+    int16_t maxC;
+    int16_t meanC;
+    uint16_t count;        // Valid samples in the window
+    uint32_t secondsAbove; // Time spent above the alarm high threshold
+} temp_frame_aggregate_t;
+
+// Sender's radio link state
+typedef struct __attribute__((packed)) {
+    int8_t txPower;  // 0.25 dBm units
+    uint8_t phyRate; // Rate ladder index (0 = LR 250K ... 7 = 54M)
+    uint8_t ackPct;  // ACK success over the last 32 unicasts
+} temp_frame_link_t;
+
+// Delivery statistics since the previous diagnostics report
+#define TEMP_FRAME_DIAG_BUCKETS 6
+typedef struct __attribute__((packed)) {
+    uint16_t attempts;           // Unicast frames sent (incl. retries and channel probes)
+    uint16_t acked;
+    uint16_t retries;            // Application-level resends
+    uint8_t consecutiveFails;    // Current run of failures
+    uint8_t maxConsecutiveFails;
+    uint8_t latency[TEMP_FRAME_DIAG_BUCKETS]; // ACK latency: <2, <5, <10, <20, <50, >=50 ms
+    int8_t rssiLast;             // Last frame received from the gateway (dBm), 0 = none
+    int8_t rssiAvg;
+} temp_frame_diag_t;
+
+// --- Varint helpers ---
+
+static inline uint32_t tempFrameZigZag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t tempFrameUnZigZag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static inline size_t tempFrameVarintLen(uint32_t v) {
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static inline size_t tempFramePutVarint(uint8_t* out, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// Returns bytes consumed, 0 on truncated/overlong input
+static inline size_t tempFrameGetVarint(const uint8_t* in, size_t len, uint32_t* v) {
+    uint32_t result = 0;
+    for (size_t i = 0; i < len && i < 5; i++) {
+        result |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if (!(in[i] & 0x80)) {
+            *v = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// --- Encoder ---
+
+class TempFrameEncoder {
+public:
+    TempFrameEncoder(uint8_t* buf, size_t capacity)
+        : _buf(buf), _cap(capacity > TEMP_FRAME_MAX_LEN ? TEMP_FRAME_MAX_LEN : capacity) {}
+
+    bool begin(const temp_frame_header_t& hdr) {
+        if (_cap < TEMP_FRAME_HEADER_LEN) {
+            return false;
+        }
+        _hdr = hdr;
+        _hdr.count = 0;
+        _len = TEMP_FRAME_HEADER_LEN;
+        writeHeader();
+        return true;
+    }
+
+    // Appends a sample (oldest first). Returns false, leaving the frame intact, if it does not
+    // fit or its seq cannot be expressed (out of order, or a gap without TEMP_FRAME_FLAG_SEQ_GAPS).
+    bool addSample(uint32_t timestamp, int16_t centiC, uint32_t seq) {
+        if (_hdr.count == 0xFF) {
+            return false;
+        }
+        bool gaps = _hdr.flags & TEMP_FRAME_FLAG_SEQ_GAPS;
+        uint32_t a, b, g = 0;
+        if (_hdr.count == 0) {
+            if (seq != _hdr.firstSeq) {
+                return false;
+            }
+            a = _hdr.deviceTime - timestamp;
+            b = tempFrameZigZag(centiC);
+        } else {
+            if (seq <= _lastSeq || (!gaps && seq != _lastSeq + 1)) {
+                return false;
+            }
+            g = seq - _lastSeq - 1;
+            a = tempFrameZigZag((int32_t)(timestamp - _lastTime) - (int32_t)_hdr.intervalSec);
+            b = tempFrameZigZag((int32_t)centiC - (int32_t)_lastTemp);
+        }
+        size_t gLen = (gaps && _hdr.count > 0) ? tempFrameVarintLen(g) : 0;
+        if (_len + gLen + tempFrameVarintLen(a) + tempFrameVarintLen(b) > reservedEnd()) {
+            return false;
+        }
+        if (gLen) {
+            _len += tempFramePutVarint(_buf + _len, g);
+        }
+        _len += tempFramePutVarint(_buf + _len, a);
+        _len += tempFramePutVarint(_buf + _len, b);
+        _lastTime = timestamp;
+        _lastTemp = centiC;
+        _lastSeq = seq;
+        _hdr.count++;
+        _buf[10] = _hdr.count;
+        return true;
+    }
+
+    // Bytes held back at the end of the frame for optional sections
+    void reserve(size_t bytes) { _reserved = bytes; }
+
+    // Raw access for optional sections appended after the samples
+    bool appendBytes(const void* data, size_t len) {
+        if (_len + len > _cap) {
+            return false;
+        }
+        memcpy(_buf + _len, data, len);
+        _len += len;
+        return true;
+    }
+
+    void setFlags(uint8_t flags) {
+        _hdr.flags = flags;
+        _buf[2] = flags;
+    }
+
+    uint8_t count() const { return _hdr.count; }
+    size_t length() const { return _len; }
+
+private:
+    size_t reservedEnd() const { return _cap > _reserved ? _cap - _reserved : 0; }
+
+    void writeHeader() {
+        _buf[0] = TEMP_FRAME_ID;
+        _buf[1] = TEMP_FRAME_VERSION;
+        _buf[2] = _hdr.flags;
+        _buf[3] = _hdr.hardwareVersion;
+        memcpy(_buf + 4, &_hdr.deviceTime, 4);
+        memcpy(_buf + 8, &_hdr.intervalSec, 2);
+        _buf[10] = _hdr.count;
+        memcpy(_buf + 11, &_hdr.firstSeq, 4);
+    }
+
+    uint8_t* _buf;
+    size_t _cap;
+    size_t _len = 0;
+    size_t _reserved = 0;
+    temp_frame_header_t _hdr = {};
+    uint32_t _lastTime = 0;
+    int16_t _lastTemp = 0;
+    uint32_t _lastSeq = 0;
+};
+
+// --- Decoder ---
+
+// Decodes up to maxSamples samples. Returns the offset of the first byte after the
+// samples (start of the optional sections), or 0 if the frame is malformed.
+static inline size_t tempFrameDecode(const uint8_t* buf, size_t len, temp_frame_header_t* hdr,
+                                     temp_frame_sample_t* samples, size_t maxSamples) {
+    if (len < TEMP_FRAME_HEADER_LEN || buf[0] != TEMP_FRAME_ID || buf[1] != TEMP_FRAME_VERSION) {
+        return 0;
+    }
+    hdr->flags = buf[2];
+    hdr->hardwareVersion = buf[3];
+    memcpy(&hdr->deviceTime, buf + 4, 4);
+    memcpy(&hdr->intervalSec, buf + 8, 2);
+    hdr->count = buf[10];
+    memcpy(&hdr->firstSeq, buf + 11, 4);
+
+    size_t pos = TEMP_FRAME_HEADER_LEN;
+    uint32_t t = 0;
+    uint32_t seq = hdr->firstSeq;
+    int32_t c = 0;
+    for (uint8_t i = 0; i < hdr->count; i++) {
+        uint32_t a, b, g = 0;
+        size_t n;
+        if (i > 0 && (hdr->flags & TEMP_FRAME_FLAG_SEQ_GAPS)) {
+            n = tempFrameGetVarint(buf + pos, len - pos, &g);
+            if (n == 0) {
+                return 0;
+            }
+            pos += n;
+        }
+        n = tempFrameGetVarint(buf + pos, len - pos, &a);
+        if (n == 0) {
+            return 0;
+        }
+        pos += n;
+        n = tempFrameGetVarint(buf + pos, len - pos, &b);
+        if (n == 0) {
+            return 0;
+        }
+        pos += n;
+
+        if (i == 0) {
+            t = hdr->deviceTime - a;
+            c = tempFrameUnZigZag(b);
+        } else {
+            seq = seq + 1 + g;
+            t = t + hdr->intervalSec + tempFrameUnZigZag(a);
+            c = c + tempFrameUnZigZag(b);
+        }
+        if (i < maxSamples) {
+            samples[i].timestamp = t;
+            samples[i].seq = seq;
+            samples[i].centiC = (int16_t)c;
+        }
+    }
+    return pos;
+}
+
+// Reads the TEMP_FRAME_FLAG_AGGREGATES section at pos (the offset returned by tempFrameDecode).
+// Returns the offset after the section, or 0 if it is truncated.
+static inline size_t tempFrameDecodeAggregates(const uint8_t* buf, size_t len, size_t pos,
+                                               temp_frame_aggregate_t* out, uint8_t* count, size_t maxOut) {
+    if (pos >= len) {
+        return 0;
+    }
+    uint8_t n = buf[pos++];
+    if (pos + n * sizeof(temp_frame_aggregate_t) > len) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < n && i < maxOut; i++) {
+        memcpy(&out[i], buf + pos + i * sizeof(temp_frame_aggregate_t), sizeof(temp_frame_aggregate_t));
+    }
+    *count = n;
+    return pos + n * sizeof(temp_frame_aggregate_t);
+}
+
+// Reads the TEMP_FRAME_FLAG_LINK section at pos (after any earlier sections).
+// Returns the offset after the section, or 0 if it is truncated.
+static inline size_t tempFrameDecodeLink(const uint8_t* buf, size_t len, size_t pos, temp_frame_link_t* out) {
+    if (pos + sizeof(temp_frame_link_t) > len) {
+        return 0;
+    }
+    memcpy(out, buf + pos, sizeof(temp_frame_link_t));
+    return pos + sizeof(temp_frame_link_t);
+}
+
+// Reads the TEMP_FRAME_FLAG_DIAG section at pos (after any earlier sections).
+// Returns the offset after the section, or 0 if it is truncated.
+static inline size_t tempFrameDecodeDiag(const uint8_t* buf, size_t len, size_t pos, temp_frame_diag_t* out) {
+    if (pos + sizeof(temp_frame_diag_t) > len) {
+        return 0;
+    }
+    memcpy(out, buf + pos, sizeof(temp_frame_diag_t));
+    return pos + sizeof(temp_frame_diag_t);
+}
+
+#endif // TEMP_FRAME_CODEC_H
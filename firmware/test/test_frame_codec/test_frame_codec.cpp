@@ -0,0 +1,352 @@
+// Host round-trip tests for temp_frame_codec.h. Run with: pio test -e native
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include "temp_frame_codec.h"
+
+#define MAX_SAMPLES 256
+
+// Deterministic xorshift so failures reproduce
+static uint32_t s_rng = 0x12345678;
+
+static uint32_t rng() {
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static int32_t rngRange(int32_t lo, int32_t hi) {
+    return lo + (int32_t)(rng() % (uint32_t)(hi - lo + 1));
+}
+
+static temp_frame_header_t makeHeader(uint8_t flags, uint32_t firstSeq) {
+    temp_frame_header_t hdr = {};
+    hdr.flags = flags;
+    hdr.hardwareVersion = 2;
+    hdr.deviceTime = 1000000 + rng() % 1000000;
+    hdr.intervalSec = 60;
+    hdr.firstSeq = firstSeq;
+    return hdr;
+}
+
+// Fills a frame with a random walk until it is full. Returns the samples that were accepted.
+static uint8_t fillRandom(TempFrameEncoder& enc, const temp_frame_header_t& hdr, temp_frame_sample_t* out,
+                          bool gaps) {
+    uint32_t t = hdr.deviceTime - 200 * hdr.intervalSec;
+    uint32_t seq = hdr.firstSeq;
+    int32_t c = rngRange(-4000, 8000);
+    uint8_t n = 0;
+    for (;;) { // Until the frame (or its 255-sample count) is full
+        if (n > 0) {
+            t += hdr.intervalSec + rngRange(-3, 3);
+            seq += 1 + (gaps ? rngRange(0, 2) * rngRange(0, 40) : 0);
+            c += rngRange(-25, 25);
+        }
+        if (!enc.addSample(t, (int16_t)c, seq)) {
+            break;
+        }
+        out[n++] = { t, seq, (int16_t)c };
+    }
+    return n;
+}
+
+static void assertSamplesEqual(const temp_frame_sample_t* expected, const temp_frame_sample_t* actual, uint8_t n) {
+    for (uint8_t i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_UINT32(expected[i].timestamp, actual[i].timestamp);
+        TEST_ASSERT_EQUAL_UINT32(expected[i].seq, actual[i].seq);
+        TEST_ASSERT_EQUAL_INT16(expected[i].centiC, actual[i].centiC);
+    }
+}
+
+static void roundTripRandom(bool gaps) {
+    for (int run = 0; run < 500; run++) {
+        uint8_t frame[TEMP_FRAME_MAX_LEN];
+        temp_frame_sample_t sent[MAX_SAMPLES], got[MAX_SAMPLES];
+        temp_frame_header_t hdr = makeHeader(gaps ? TEMP_FRAME_FLAG_SEQ_GAPS : 0, rng() % 100000);
+
+        TempFrameEncoder enc(frame, sizeof(frame));
+        TEST_ASSERT_TRUE(enc.begin(hdr));
+        uint8_t n = fillRandom(enc, hdr, sent, gaps);
+        TEST_ASSERT_EQUAL_UINT8(n, enc.count());
+        TEST_ASSERT_TRUE(enc.length() <= TEMP_FRAME_MAX_LEN);
+
+        temp_frame_header_t decoded;
+        size_t pos = tempFrameDecode(frame, enc.length(), &decoded, got, MAX_SAMPLES);
+        TEST_ASSERT_EQUAL(enc.length(), pos);
+        TEST_ASSERT_EQUAL_UINT8(n, decoded.count);
+        TEST_ASSERT_EQUAL_UINT8(hdr.flags, decoded.flags);
+        TEST_ASSERT_EQUAL_UINT8(hdr.hardwareVersion, decoded.hardwareVersion);
+        TEST_ASSERT_EQUAL_UINT32(hdr.deviceTime, decoded.deviceTime);
+        TEST_ASSERT_EQUAL_UINT16(hdr.intervalSec, decoded.intervalSec);
+        TEST_ASSERT_EQUAL_UINT32(hdr.firstSeq, decoded.firstSeq);
+        assertSamplesEqual(sent, got, n);
+    }
+}
+
+void test_round_trip_consecutive_seq() {
+    roundTripRandom(false);
+}
+
+void test_round_trip_seq_gaps() {
+    roundTripRandom(true);
+}
+
+void test_steady_sampling_density() {
+    uint8_t frame[TEMP_FRAME_MAX_LEN];
+    temp_frame_header_t hdr = makeHeader(0, 0);
+    TempFrameEncoder enc(frame, sizeof(frame));
+    enc.begin(hdr);
+    uint32_t t = hdr.deviceTime - 1000;
+    while (enc.addSample(t + enc.count() * hdr.intervalSec, 2150 + (enc.count() % 3), enc.count())) {
+    }
+    // ~2 bytes per reading on a steady signal
+    TEST_ASSERT_GREATER_OR_EQUAL(100, enc.count());
+}
+
+void test_extreme_values() {
+    uint8_t frame[TEMP_FRAME_MAX_LEN];
+    temp_frame_sample_t got[8];
+    temp_frame_header_t hdr = makeHeader(TEMP_FRAME_FLAG_SEQ_GAPS, 0xFFFFFF00);
+    hdr.deviceTime = 0xFFFFFFF0;
+    const temp_frame_sample_t sent[] = {
+        { 0, 0xFFFFFF00, INT16_MIN },          // Oldest possible time, invalid reading
+        { 60, 0xFFFFFF01, INT16_MAX },         // Largest temperature swing
+        { 0x7FFFFFFF, 0xFFFFFFF0, TEMP_FRAME_INVALID_TEMP },
+        { 0xFFFFFFF0, 0xFFFFFFFF, 0 },         // Sampled at send time, last seq
+    };
+    TempFrameEncoder enc(frame, sizeof(frame));
+    enc.begin(hdr);
+    for (const temp_frame_sample_t& s : sent) {
+        TEST_ASSERT_TRUE(enc.addSample(s.timestamp, s.centiC, s.seq));
+    }
+    temp_frame_header_t decoded;
+    TEST_ASSERT_EQUAL(enc.length(), tempFrameDecode(frame, enc.length(), &decoded, got, 8));
+    TEST_ASSERT_EQUAL_UINT8(4, decoded.count);
+    assertSamplesEqual(sent, got, 4);
+}
+
+void test_encoder_rejects_unencodable_seq() {
+    uint8_t frame[TEMP_FRAME_MAX_LEN];
+    temp_frame_header_t hdr = makeHeader(0, 10);
+    TempFrameEncoder enc(frame, sizeof(frame));
+    enc.begin(hdr);
+    TEST_ASSERT_FALSE(enc.addSample(hdr.deviceTime, 100, 11)); // First seq must match the header
+    TEST_ASSERT_TRUE(enc.addSample(hdr.deviceTime, 100, 10));
+    size_t len = enc.length();
+    TEST_ASSERT_FALSE(enc.addSample(hdr.deviceTime, 100, 12)); // Gap without TEMP_FRAME_FLAG_SEQ_GAPS
+    TEST_ASSERT_FALSE(enc.addSample(hdr.deviceTime, 100, 10)); // Repeat
+    TEST_ASSERT_FALSE(enc.addSample(hdr.deviceTime, 100, 9));  // Out of order
+    // Rejected samples leave the frame intact
+    TEST_ASSERT_EQUAL(len, enc.length());
+    TEST_ASSERT_EQUAL_UINT8(1, enc.count());
+    TEST_ASSERT_EQUAL_UINT8(1, frame[10]);
+}
+
+void test_truncated_input() {
+    for (int gaps = 0; gaps < 2; gaps++) {
+        uint8_t frame[TEMP_FRAME_MAX_LEN];
+        temp_frame_sample_t sent[MAX_SAMPLES], got[MAX_SAMPLES];
+        temp_frame_header_t hdr = makeHeader(gaps ? TEMP_FRAME_FLAG_SEQ_GAPS : 0, 1);
+        TempFrameEncoder enc(frame, sizeof(frame));
+        enc.begin(hdr);
+        fillRandom(enc, hdr, sent, gaps);
+
+        // Every cut short of the last sample byte is malformed
+        temp_frame_header_t decoded;
+        for (size_t len = 0; len < enc.length(); len++) {
+            TEST_ASSERT_EQUAL(0, tempFrameDecode(frame, len, &decoded, got, MAX_SAMPLES));
+        }
+    }
+}
+
+void test_oversize_input() {
+    // Trailing bytes beyond the samples are left to the section readers
+    uint8_t frame[400];
+    memset(frame, 0xA5, sizeof(frame));
+    temp_frame_sample_t sent[MAX_SAMPLES], got[MAX_SAMPLES];
+    temp_frame_header_t hdr = makeHeader(0, 1);
+    TempFrameEncoder enc(frame, sizeof(frame));
+    enc.begin(hdr);
+    uint8_t n = fillRandom(enc, hdr, sent, false);
+    // The encoder never exceeds the ESP-NOW payload, whatever buffer it is given
+    TEST_ASSERT_TRUE(enc.length() <= TEMP_FRAME_MAX_LEN);
+
+    temp_frame_header_t decoded;
+    TEST_ASSERT_EQUAL(enc.length(), tempFrameDecode(frame, sizeof(frame), &decoded, got, MAX_SAMPLES));
+    assertSamplesEqual(sent, got, n);
+
+    // Fewer output slots than samples: the offset is still the end of the samples
+    TEST_ASSERT_EQUAL(enc.length(), tempFrameDecode(frame, sizeof(frame), &decoded, got, 3));
+    assertSamplesEqual(sent, got, 3);
+}
+
+void test_malformed_header_and_varint() {
+    uint8_t frame[TEMP_FRAME_MAX_LEN];
+    temp_frame_sample_t got[4];
+    temp_frame_header_t decoded;
+    temp_frame_header_t hdr = makeHeader(0, 0);
+    TempFrameEncoder enc(frame, sizeof(frame));
+    enc.begin(hdr);
+    enc.addSample(hdr.deviceTime, 100, 0);
+    size_t len = enc.length();
+
+    frame[0] = TEMP_FRAME_ID + 1;
+    TEST_ASSERT_EQUAL(0, tempFrameDecode(frame, len, &decoded, got, 4));
+    frame[0] = TEMP_FRAME_ID;
+    frame[1] = TEMP_FRAME_VERSION + 1;
+    TEST_ASSERT_EQUAL(0, tempFrameDecode(frame, len, &decoded, got, 4));
+    frame[1] = TEMP_FRAME_VERSION;
+
+    // More than 5 continuation bytes is not a valid uint32 varint
+    memset(frame + TEMP_FRAME_HEADER_LEN, 0xFF, 8);
+    TEST_ASSERT_EQUAL(0, tempFrameDecode(frame, TEMP_FRAME_HEADER_LEN + 8, &decoded, got, 4));
+
+    // Count claims more samples than the frame holds
+    enc.begin(hdr);
+    enc.addSample(hdr.deviceTime, 100, 0);
+    frame[10] = 2;
+    TEST_ASSERT_EQUAL(0, tempFrameDecode(frame, enc.length(), &decoded, got, 4));
+}
+
+// Builds a frame with the sections in `flags`, decodes them back and checks each one
+static void roundTripSections(uint8_t flags, bool withSamples) {
+    uint8_t frame[TEMP_FRAME_MAX_LEN];
+    temp_frame_sample_t sent[MAX_SAMPLES] = {}, got[MAX_SAMPLES];
+    temp_frame_aggregate_t aggregates[2] = {
+        { 3600, 3600, -120, 2400, 1100, 60, 300 },
+        { 0, 86400, -500, 3100, 1200, 1440, 7200 },
+    };
+    temp_frame_link_t link = { 34, 5, 97 };
+    temp_frame_diag_t diag = { 120, 117, 3, 0, 2, { 50, 40, 20, 5, 2, 0 }, -71, -68 };
+
+    temp_frame_header_t hdr = makeHeader(flags & TEMP_FRAME_FLAG_SEQ_GAPS, 500);
+    uint8_t aggregateCount = 2;
+    size_t sections = ((flags & TEMP_FRAME_FLAG_AGGREGATES) ? 1 + sizeof(aggregates) : 0) +
+                      ((flags & TEMP_FRAME_FLAG_LINK) ? sizeof(link) : 0) +
+                      ((flags & TEMP_FRAME_FLAG_DIAG) ? sizeof(diag) : 0);
+
+    TempFrameEncoder enc(frame, sizeof(frame));
+    enc.begin(hdr);
+    enc.reserve(sections);
+    uint8_t n = withSamples ? fillRandom(enc, hdr, sent, flags & TEMP_FRAME_FLAG_SEQ_GAPS) : 0;
+    if (flags & TEMP_FRAME_FLAG_AGGREGATES) {
+        TEST_ASSERT_TRUE(enc.appendBytes(&aggregateCount, 1));
+        TEST_ASSERT_TRUE(enc.appendBytes(aggregates, sizeof(aggregates)));
+    }
+    if (flags & TEMP_FRAME_FLAG_LINK) {
+        TEST_ASSERT_TRUE(enc.appendBytes(&link, sizeof(link)));
+    }
+    if (flags & TEMP_FRAME_FLAG_DIAG) {
+        TEST_ASSERT_TRUE(enc.appendBytes(&diag, sizeof(diag)));
+    }
+    enc.setFlags(flags);
+    TEST_ASSERT_TRUE(enc.length() <= TEMP_FRAME_MAX_LEN);
+
+    temp_frame_header_t decoded;
+    size_t pos = tempFrameDecode(frame, enc.length(), &decoded, got, MAX_SAMPLES);
+    TEST_ASSERT_NOT_EQUAL(0, pos);
+    TEST_ASSERT_EQUAL_UINT8(flags, decoded.flags);
+    TEST_ASSERT_EQUAL_UINT8(n, decoded.count);
+    assertSamplesEqual(sent, got, n);
+
+    if (decoded.flags & TEMP_FRAME_FLAG_AGGREGATES) {
+        temp_frame_aggregate_t out[2];
+        uint8_t count = 0;
+        pos = tempFrameDecodeAggregates(frame, enc.length(), pos, out, &count, 2);
+        TEST_ASSERT_NOT_EQUAL(0, pos);
+        TEST_ASSERT_EQUAL_UINT8(2, count);
+        TEST_ASSERT_EQUAL_MEMORY(aggregates, out, sizeof(aggregates));
+    }
+    if (decoded.flags & TEMP_FRAME_FLAG_LINK) {
+        temp_frame_link_t out;
+        pos = tempFrameDecodeLink(frame, enc.length(), pos, &out);
+        TEST_ASSERT_NOT_EQUAL(0, pos);
+        TEST_ASSERT_EQUAL_MEMORY(&link, &out, sizeof(link));
+    }
+    if (decoded.flags & TEMP_FRAME_FLAG_DIAG) {
+        temp_frame_diag_t out;
+        pos = tempFrameDecodeDiag(frame, enc.length(), pos, &out);
+        TEST_ASSERT_NOT_EQUAL(0, pos);
+        TEST_ASSERT_EQUAL_MEMORY(&diag, &out, sizeof(diag));
+    }
+    TEST_ASSERT_EQUAL(enc.length(), pos);
+}
+
+void test_optional_sections() {
+    const uint8_t sectionFlags = TEMP_FRAME_FLAG_AGGREGATES | TEMP_FRAME_FLAG_LINK | TEMP_FRAME_FLAG_DIAG;
+    for (uint8_t flags = 0; flags <= sectionFlags; flags++) {
+        if (flags & ~sectionFlags) {
+            continue;
+        }
+        roundTripSections(flags, true);
+        roundTripSections(flags | TEMP_FRAME_FLAG_SEQ_GAPS, true);
+        roundTripSections(flags, false); // Status frame: sections only
+    }
+}
+
+void test_truncated_sections() {
+    uint8_t frame[TEMP_FRAME_MAX_LEN];
+    temp_frame_aggregate_t aggregates[2] = {};
+    temp_frame_link_t link = {};
+    temp_frame_diag_t diag = {};
+    uint8_t aggregateCount = 2;
+    temp_frame_header_t hdr = makeHeader(0, 0);
+    TempFrameEncoder enc(frame, sizeof(frame));
+    enc.begin(hdr);
+    enc.addSample(hdr.deviceTime, 100, 0);
+    size_t samplesEnd = enc.length();
+    enc.appendBytes(&aggregateCount, 1);
+    enc.appendBytes(aggregates, sizeof(aggregates));
+    size_t linkStart = enc.length();
+    enc.appendBytes(&link, sizeof(link));
+    size_t diagStart = enc.length();
+    enc.appendBytes(&diag, sizeof(diag));
+
+    temp_frame_aggregate_t aggOut[2];
+    temp_frame_link_t linkOut;
+    temp_frame_diag_t diagOut;
+    uint8_t count;
+    TEST_ASSERT_EQUAL(0, tempFrameDecodeAggregates(frame, samplesEnd, samplesEnd, aggOut, &count, 2));
+    TEST_ASSERT_EQUAL(0, tempFrameDecodeAggregates(frame, linkStart - 1, samplesEnd, aggOut, &count, 2));
+    TEST_ASSERT_EQUAL(0, tempFrameDecodeLink(frame, diagStart - 1, linkStart, &linkOut));
+    TEST_ASSERT_EQUAL(0, tempFrameDecodeDiag(frame, enc.length() - 1, diagStart, &diagOut));
+    TEST_ASSERT_EQUAL(enc.length(), tempFrameDecodeDiag(frame, enc.length(), diagStart, &diagOut));
+}
+
+void test_reserve_keeps_room_for_sections() {
+    uint8_t frame[TEMP_FRAME_MAX_LEN];
+    temp_frame_sample_t sent[MAX_SAMPLES];
+    temp_frame_diag_t diag = {};
+    temp_frame_header_t hdr = makeHeader(0, 0);
+    TempFrameEncoder enc(frame, sizeof(frame));
+    enc.begin(hdr);
+    enc.reserve(sizeof(diag));
+    fillRandom(enc, hdr, sent, false);
+    TEST_ASSERT_TRUE(enc.length() + sizeof(diag) <= TEMP_FRAME_MAX_LEN);
+    TEST_ASSERT_TRUE(enc.appendBytes(&diag, sizeof(diag)));
+    // Past the capacity nothing is appended
+    size_t len = enc.length();
+    uint8_t filler[TEMP_FRAME_MAX_LEN] = {};
+    TEST_ASSERT_FALSE(enc.appendBytes(filler, TEMP_FRAME_MAX_LEN - len + 1));
+    TEST_ASSERT_EQUAL(len, enc.length());
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_consecutive_seq);
+    RUN_TEST(test_round_trip_seq_gaps);
+    RUN_TEST(test_steady_sampling_density);
+    RUN_TEST(test_extreme_values);
+    RUN_TEST(test_encoder_rejects_unencodable_seq);
+    RUN_TEST(test_truncated_input);
+    RUN_TEST(test_oversize_input);
+    RUN_TEST(test_malformed_header_and_varint);
+    RUN_TEST(test_optional_sections);
+    RUN_TEST(test_truncated_sections);
+    RUN_TEST(test_reserve_keeps_room_for_sections);
+    return UNITY_END();
+}
@@ -0,0 +1,100 @@
+// Host throughput benchmark for temp_frame_codec.h. Run with: pio test -e native -v
+// (-v shows the figures). Each run also re-checks the decoded samples.
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include "temp_frame_codec.h"
+
+#define BENCH_FRAMES 200000
+#define BENCH_SAMPLE_SLOTS 256
+
+typedef std::chrono::steady_clock BenchClock;
+
+static temp_frame_sample_t s_input[BENCH_SAMPLE_SLOTS];
+static uint8_t s_frame[TEMP_FRAME_MAX_LEN];
+
+// Steady 60 s sampling with small jitter and a slow random walk, like a real sensor
+static void makeInput(const temp_frame_header_t& hdr) {
+    uint32_t rng = 0xC0FFEE;
+    int32_t c = 2150;
+    for (int i = 0; i < BENCH_SAMPLE_SLOTS; i++) {
+        rng = rng * 1664525 + 1013904223;
+        c += (int32_t)((rng >> 16) % 11) - 5;
+        s_input[i].timestamp = hdr.deviceTime - (BENCH_SAMPLE_SLOTS - i) * hdr.intervalSec + (rng >> 28) % 3;
+        s_input[i].seq = hdr.firstSeq + i;
+        s_input[i].centiC = (int16_t)c;
+    }
+}
+
+static uint8_t encodeFrame(const temp_frame_header_t& hdr) {
+    TempFrameEncoder enc(s_frame, sizeof(s_frame));
+    enc.begin(hdr);
+    for (int i = 0; i < BENCH_SAMPLE_SLOTS; i++) {
+        if (!enc.addSample(s_input[i].timestamp, s_input[i].centiC, s_input[i].seq)) {
+            break;
+        }
+    }
+    return enc.count();
+}
+
+static double elapsedSec(BenchClock::time_point start) {
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+void test_codec_throughput() {
+    temp_frame_header_t hdr = {};
+    hdr.deviceTime = 1700000000;
+    hdr.intervalSec = 60;
+    hdr.firstSeq = 1000;
+    makeInput(hdr);
+
+    uint8_t perFrame = encodeFrame(hdr);
+    TEST_ASSERT_GREATER_THAN(0, perFrame);
+
+    uint64_t encoded = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        encoded += encodeFrame(hdr);
+    }
+    double encodeSec = elapsedSec(start);
+
+    static temp_frame_sample_t decoded[BENCH_SAMPLE_SLOTS];
+    temp_frame_header_t out = {};
+    size_t len = TEMP_FRAME_HEADER_LEN;
+    uint64_t checksum = 0;
+    start = BenchClock::now();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        len = tempFrameDecode(s_frame, sizeof(s_frame), &out, decoded, BENCH_SAMPLE_SLOTS);
+        checksum += decoded[i % perFrame].centiC;
+    }
+    double decodeSec = elapsedSec(start);
+
+    TEST_ASSERT_NOT_EQUAL(0, len);
+    TEST_ASSERT_EQUAL_UINT8(perFrame, out.count);
+    for (uint8_t i = 0; i < out.count; i++) {
+        TEST_ASSERT_EQUAL_UINT32(s_input[i].timestamp, decoded[i].timestamp);
+        TEST_ASSERT_EQUAL_INT16(s_input[i].centiC, decoded[i].centiC);
+    }
+
+    char line[160];
+    snprintf(line, sizeof(line), "%u samples/frame in %u bytes (%.2f B/sample)",
+             perFrame, (unsigned)len, (double)(len - TEMP_FRAME_HEADER_LEN) / perFrame);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "encode: %.1f M samples/s, %.0f k frames/s",
+             encoded / encodeSec / 1e6, BENCH_FRAMES / encodeSec / 1e3);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "decode: %.1f M samples/s, %.0f k frames/s (checksum %llu)",
+             (double)BENCH_FRAMES * perFrame / decodeSec / 1e6, BENCH_FRAMES / decodeSec / 1e3,
+             (unsigned long long)checksum);
+    TEST_MESSAGE(line);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_codec_throughput);
+    return UNITY_END();
+}
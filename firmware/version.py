@@ -10,3 +10,13 @@ print(f"## PIO: OTA_VERSION set to {ver}")
 hw_ver = os.environ.get("HW_VERSION", "1")
 env.Append(CPPDEFINES=[("HW_VERSION", hw_ver)])
 print(f"## PIO: HW_VERSION set to {hw_ver}")
+
+# Release builds (scripts/build_release.sh): warnings and errors only, silent timer wakes
+if os.environ.get("RELEASE_BUILD") == "1":
+    env.Append(CPPDEFINES=[("LOG_LEVEL", "2"), ("LOG_TIMER_WAKE_SERIAL", "0")])
+    print("## PIO: Release logging (LOG_LEVEL_WARN, no serial on timer wakes)")
+else:
+    # Per-wake heap allocation counter (services/alloc_counter.cpp)
+    env.Append(CPPDEFINES=[("WAKE_ALLOC_COUNT", "1")],
+               LINKFLAGS=["-Wl,--wrap=malloc", "-Wl,--wrap=calloc", "-Wl,--wrap=realloc"])
+    print("## PIO: Heap allocation counter enabled")
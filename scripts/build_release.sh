@@ -44,6 +44,7 @@ echo "========================================="
 # Set environment variables for version.py
 export OTA_VERSION="$VERSION"
 export HW_VERSION="$HW_VERSION"
+export RELEASE_BUILD=1
 
 # Run PlatformIO Build
 echo "Running build..."